@@ -20,8 +20,14 @@
 
 #include <QMutex>
 #include <QWaitCondition>
+#include <QAtomicInt>
+#include "dsp/dsptypes.h"
+#include "util/metrics.h"
 #include "util/export.h"
 
+// Single producer, single consumer ring. read() and write() never take a lock unless the caller
+// asked for a blocking timeout and the fifo is empty / full. drain() runs on the reader side,
+// clear() may be called from either side and takes effect on the reader's next read().
 class SDRANGELOVE_API AudioFifo {
 public:
 	AudioFifo();
@@ -36,39 +42,75 @@ public:
 	uint drain(uint numSamples);
 	void clear();
 
-	uint flush() { return drain(m_fill); }
-	uint fill() const { return m_fill; }
-	bool isEmpty() const { return m_fill == 0; }
-	bool isFull() const { return m_fill == m_size; }
+	uint flush() { return drain(fill()); }
+	uint fill() const { return m_fill.loadAcquire(); }
+	bool isEmpty() const { return fill() == 0; }
+	bool isFull() const { return fill() == m_size; }
 	uint size() const { return m_size; }
 
 	quint32 getSampleRate() const { return m_sampleRate; }
 	void setSampleRate(quint32 rate) { m_sampleRate = rate; }
 
-	bool isStopped() const { return m_stopped; }
-	void setStopped(bool stopped) { m_stopped = stopped; }
+	// set by the writer (AudioResampler), read on the audio thread
+	bool isStopped() const { return m_stopped.loadAcquire() != 0; }
+	void setStopped(bool stopped) { m_stopped.storeRelease(stopped ? 1 : 0); }
 
-private:
-	QMutex m_mutex;
+	// set by the GUI, applied by AudioOutput while mixing, gain is stored as 4.12 fixed point
+	void setGain(Real gain);
+	Real getGain() const { return m_gain.loadAcquire() / 4096.0; }
+	qint32 getFixedGain() const { return m_gain.loadAcquire(); }
+	bool isMuted() const { return m_muted.loadAcquire() != 0; }
+	void setMuted(bool muted) { m_muted.storeRelease(muted ? 1 : 0); }
+
+	void setMetricsName(const QString& name);
 
+private:
 	qint8* m_fifo;
 
 	uint m_sampleSize;
 
 	uint m_size;
-	uint m_fill;
-	uint m_head;
-	uint m_tail;
+	QAtomicInt m_fill;
+	uint m_head; // owned by the reader
+	uint m_tail; // owned by the writer
+	QAtomicInt m_clearRequested;
 
+	// only used when a caller blocks
 	QMutex m_writeWaitLock;
 	QMutex m_readWaitLock;
 	QWaitCondition m_writeWaitCondition;
 	QWaitCondition m_readWaitCondition;
+	QAtomicInt m_writeWaiting;
+	QAtomicInt m_readWaiting;
 
 	quint32 m_sampleRate;
-	bool m_stopped;
+	QAtomicInt m_stopped;
+	QAtomicInt m_gain;
+	QAtomicInt m_muted;
+
+	// latency measurement: start and write time of the blocks, published by the writer
+	struct Marker {
+		quint64 m_begin;
+		qint64 m_written;
+		qint64 m_origin;
+	};
+	enum {
+		MaxMarkers = 32
+	};
+	Marker m_markers[MaxMarkers];
+	QAtomicInt m_markerHead; // owned by the reader
+	QAtomicInt m_markerTail; // owned by the writer
+	quint64 m_writeCount; // owned by the writer
+	quint64 m_readCount; // owned by the reader
+
+	Metric m_fillMetric; // mirrors m_fill
+	Metric m_underrunsMetric;
+	Metric m_overrunsMetric;
 
 	bool create(uint sampleSize, uint numSamples);
+	void pushMarker();
+	void popMarkers(bool record);
+	void wake(QAtomicInt& waiting, QMutex& lock, QWaitCondition& condition);
 };
 
 #endif // INCLUDE_AUDIOFIFO_H
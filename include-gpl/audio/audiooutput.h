@@ -56,7 +56,7 @@ private:
 
 	typedef std::list<AudioFifo*> AudioFifos;
 	AudioFifos m_audioFifos;
-	std::vector<qint32> m_mixBuffer;
+	std::vector<qint16> m_mixBuffer;
 
 	bool open(OpenMode mode);
 	qint64 readData(char* data, qint64 maxLen);
@@ -0,0 +1,67 @@
+#ifndef INCLUDE_AUDIORESAMPLER_H
+#define INCLUDE_AUDIORESAMPLER_H
+
+#include <vector>
+#include "dsp/dsptypes.h"
+#include "dsp/pidcontroller.h"
+#include "util/export.h"
+
+class AudioFifo;
+
+// Asynchronous sample rate converter between a demodulator and the audio device.
+// The ratio between both clocks is tracked by keeping the fifo fill at a target latency
+// with a PI loop, the audio is resampled with a windowed-sinc polyphase kernel.
+class SDRANGELOVE_API AudioResampler {
+public:
+	AudioResampler(AudioFifo* audioFifo);
+
+	void configure(int inputSampleRate, int outputSampleRate);
+	void setTargetLatency(int ms);
+	void reset();
+
+	// mono samples, full scale is +-1.0
+	void feed(const Real* samples, uint count);
+
+	Real getCorrection() const { return m_correction; }
+	int getTargetLatency() const { return m_targetLatency; }
+
+private:
+	enum {
+		PhaseSteps = 128,
+		Taps = 32
+	};
+
+	struct AudioSample {
+		qint16 l;
+		qint16 r;
+	};
+
+	AudioFifo* m_audioFifo;
+	int m_inputSampleRate;
+	int m_outputSampleRate;
+	int m_targetLatency;
+	Real m_targetFill;
+
+	// clock drift loop
+	PIDController m_pid;
+	Real m_fillAverage;
+	Real m_correction;
+	uint m_regulateCount;
+
+	Real m_distance;
+	Real m_distanceRemain;
+	std::vector<Real> m_taps; // PhaseSteps + 1 phases of Taps coefficients
+	std::vector<Real> m_history; // every sample is stored twice to get a contiguous window
+	int m_historyPos;
+
+	std::vector<AudioSample> m_buffer;
+	uint m_bufferFill;
+
+	void createTaps();
+	void regulate();
+	void flush();
+
+	Real interpolate(Real frac);
+};
+
+#endif // INCLUDE_AUDIORESAMPLER_H
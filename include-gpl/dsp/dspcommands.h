@@ -20,6 +20,12 @@ class SDRANGELOVE_API DSPExit : public Message {
 
 class SDRANGELOVE_API DSPAcquisitionStart : public Message {
 	MESSAGE_CLASS_DECLARATION(DSPAcquisitionStart)
+
+public:
+	static DSPAcquisitionStart* create()
+	{
+		return new DSPAcquisitionStart;
+	}
 };
 
 class SDRANGELOVE_API DSPAcquisitionStop : public Message {
@@ -64,12 +70,14 @@ class SDRANGELOVE_API DSPAddSink : public Message {
 	MESSAGE_CLASS_DECLARATION(DSPAddSink)
 
 public:
-	DSPAddSink(SampleSink* sampleSink) : Message(), m_sampleSink(sampleSink) { }
+	DSPAddSink(SampleSink* sampleSink, bool mainSpectrum = false) : Message(), m_sampleSink(sampleSink), m_mainSpectrum(mainSpectrum) { }
 
 	SampleSink* getSampleSink() const { return m_sampleSink; }
+	bool getMainSpectrum() const { return m_mainSpectrum; }
 
 private:
 	SampleSink* m_sampleSink;
+	bool m_mainSpectrum;
 };
 
 class SDRANGELOVE_API DSPRemoveSink : public Message {
@@ -115,22 +123,28 @@ public:
 	int getFFTSize() const { return m_fftSize; }
 	int getOverlapPercent() const { return m_overlapPercent; }
 	FFTWindow::Function getWindow() const { return m_window; }
+	int getAveragingMode() const { return m_averagingMode; }
+	int getFrameRate() const { return m_frameRate; }
 
-	static DSPConfigureSpectrumVis* create(int fftSize, int overlapPercent, FFTWindow::Function window)
+	static DSPConfigureSpectrumVis* create(int fftSize, int overlapPercent, FFTWindow::Function window, int averagingMode, int frameRate)
 	{
-		return new DSPConfigureSpectrumVis(fftSize, overlapPercent, window);
+		return new DSPConfigureSpectrumVis(fftSize, overlapPercent, window, averagingMode, frameRate);
 	}
 
 private:
 	int m_fftSize;
 	int m_overlapPercent;
 	FFTWindow::Function m_window;
+	int m_averagingMode;
+	int m_frameRate;
 
-	DSPConfigureSpectrumVis(int fftSize, int overlapPercent, FFTWindow::Function window) :
+	DSPConfigureSpectrumVis(int fftSize, int overlapPercent, FFTWindow::Function window, int averagingMode, int frameRate) :
 		Message(),
 		m_fftSize(fftSize),
 		m_overlapPercent(overlapPercent),
-		m_window(window)
+		m_window(window),
+		m_averagingMode(averagingMode),
+		m_frameRate(frameRate)
 	{ }
 };
 
@@ -157,6 +171,26 @@ private:
 	{ }
 };
 
+class SDRANGELOVE_API DSPConfigurePipeline : public Message {
+	MESSAGE_CLASS_DECLARATION(DSPConfigurePipeline)
+
+public:
+	bool getPipelined() const { return m_pipelined; }
+
+	static DSPConfigurePipeline* create(bool pipelined)
+	{
+		return new DSPConfigurePipeline(pipelined);
+	}
+
+private:
+	bool m_pipelined;
+
+	DSPConfigurePipeline(bool pipelined) :
+		Message(),
+		m_pipelined(pipelined)
+	{ }
+};
+
 class SDRANGELOVE_API DSPConfigureAudioOutput : public Message {
 	MESSAGE_CLASS_DECLARATION(DSPConfigureAudioOutput)
 
@@ -210,22 +244,28 @@ public:
 	int getTriggerChannel() const { return m_triggerChannel; }
 	Real getTriggerLevelHigh() const { return m_triggerLevelHigh; }
 	Real getTriggerLevelLow() const { return m_triggerLevelLow; }
+	int getTraceSize() const { return m_traceSize; }
+	int getTriggerPre() const { return m_triggerPre; }
 
-	static DSPConfigureScopeVis* create(int triggerChannel, Real triggerLevelHigh, Real triggerLevelLow)
+	static DSPConfigureScopeVis* create(int triggerChannel, Real triggerLevelHigh, Real triggerLevelLow, int traceSize, int triggerPre)
 	{
-		return new DSPConfigureScopeVis(triggerChannel, triggerLevelHigh, triggerLevelLow);
+		return new DSPConfigureScopeVis(triggerChannel, triggerLevelHigh, triggerLevelLow, traceSize, triggerPre);
 	}
 
 private:
 	int m_triggerChannel;
 	Real m_triggerLevelHigh;
 	Real m_triggerLevelLow;
+	int m_traceSize;
+	int m_triggerPre;
 
-	DSPConfigureScopeVis(int triggerChannel, Real triggerLevelHigh, Real triggerLevelLow) :
+	DSPConfigureScopeVis(int triggerChannel, Real triggerLevelHigh, Real triggerLevelLow, int traceSize, int triggerPre) :
 		Message(),
 		m_triggerChannel(triggerChannel),
 		m_triggerLevelHigh(triggerLevelHigh),
-		m_triggerLevelLow(triggerLevelLow)
+		m_triggerLevelLow(triggerLevelLow),
+		m_traceSize(traceSize),
+		m_triggerPre(triggerPre)
 	{ }
 };
 
@@ -252,6 +292,27 @@ private:
 	{ }
 };
 
+// sent to every sink when the engine sheds load or recovers, see OverloadController::Level
+class SDRANGELOVE_API DSPOverloadNotification : public Message {
+	MESSAGE_CLASS_DECLARATION(DSPOverloadNotification)
+
+public:
+	int getLevel() const { return m_level; }
+
+	static DSPOverloadNotification* create(int level)
+	{
+		return new DSPOverloadNotification(level);
+	}
+
+private:
+	int m_level;
+
+	DSPOverloadNotification(int level) :
+		Message(),
+		m_level(level)
+	{ }
+};
+
 class SDRANGELOVE_API DSPConfigureChannelizer : public Message {
 	MESSAGE_CLASS_DECLARATION(DSPConfigureChannelizer)
 
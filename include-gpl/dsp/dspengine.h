@@ -25,12 +25,18 @@
 #include "dsp/dsptypes.h"
 #include "dsp/fftwindow.h"
 #include "dsp/samplefifo.h"
+#include "dsp/sinkworkerpool.h"
+#include "dsp/dsppipeline.h"
+#include "dsp/quantumscheduler.h"
+#include "dsp/overloadcontroller.h"
 #include "audio/audiooutput.h"
 #include "util/messagequeue.h"
+#include "util/messagedispatcher.h"
 #include "util/export.h"
 
 class SampleSource;
 class SampleSink;
+class DecoupledSampleSink;
 class AudioFifo;
 
 class SDRANGELOVE_API DSPEngine : public QThread {
@@ -48,32 +54,51 @@ public:
 	~DSPEngine();
 
 	MessageQueue* getMessageQueue() { return &m_messageQueue; }
+	// shared threads for the channel chains, see PooledSampleSink
+	SinkWorkerPool* getSinkWorkerPool() { return &m_sinkWorkerPool; }
+	// wraps the chain of a new channel in a PooledSampleSink or, if pooled channel sinks are
+	// off, in a ThreadedSampleSink with a thread of its own - called from the GUI thread only
+	DecoupledSampleSink* createChannelSink(SampleSink* sampleSink);
+	void setPooledChannelSinks(bool pooled) { m_pooledChannelSinks = pooled; }
 
 	void start();
 	void stop();
 
 	bool startAcquisition();
+	// returns right away, DSPAcquisitionStart comes back through replyQueue with the new state
+	void startAcquisition(MessageQueue* replyQueue);
 	void stopAcquistion();
 
 	void setSource(SampleSource* source);
 
-	void addSink(SampleSink* sink);
+	// the main spectrum gets a stage of its own in pipelined mode
+	void addSink(SampleSink* sink, bool mainSpectrum = false);
 	void removeSink(SampleSink* sink);
 
 	void addAudioSource(AudioFifo* audioFifo);
 	void removeAudioSource(AudioFifo* audioFifo);
 
 	void configureCorrections(bool dcOffsetCorrection, bool iqImbalanceCorrection);
+	void configurePipeline(bool pipelined);
 	void configureAudioOutput(const QString& audioOutput, quint32 audioOutputRate);
 
 	State state() const { return m_state; }
+	// how far behind realtime the engine is, load and missed quantum deadlines
+	const QuantumScheduler* getScheduler() const { return &m_scheduler; }
+	// how much work is shed because the engine cannot keep up
+	OverloadController::Level getOverloadLevel() const { return m_overload.getLevel(); }
 
 	QString errorMessage();
 	QString deviceDescription();
 
 private:
+	enum {
+		AddTimeoutMs = 100 // longest the GUI waits for the engine to add a sink or audio source
+	};
+
 	MessageQueue m_messageQueue;
 	MessageQueue* m_reportQueue;
+	MessageDispatcher<DSPEngine> m_dispatcher;
 
 	State m_state;
 
@@ -84,7 +109,13 @@ private:
 
 	typedef std::list<SampleSink*> SampleSinks;
 	SampleSinks m_sampleSinks;
+	SampleSink* m_mainSpectrumSink;
+	DSPPipeline m_pipeline;
+	QuantumScheduler m_scheduler;
+	OverloadController m_overload;
 
+	SinkWorkerPool m_sinkWorkerPool;
+	bool m_pooledChannelSinks;
 	AudioOutput m_audioOutput;
 
 	uint m_sampleRate;
@@ -102,7 +133,14 @@ private:
 
 	void dcOffset(SampleVector::iterator begin, SampleVector::iterator end);
 	void imbalance(SampleVector::iterator begin, SampleVector::iterator end);
+	void correct(SampleVector::iterator begin, SampleVector::iterator end);
 	void work();
+	void workPipelined();
+	bool continueBurst(SampleFifo* sampleFifo);
+	void shedBacklog(SampleFifo* sampleFifo);
+	void updateOverload(SampleFifo* sampleFifo);
+	void notifyOverload();
+	void drainPipeline();
 
 	State gotoIdle();
 	State gotoRunning();
@@ -112,6 +150,23 @@ private:
 	void generateReport();
 	bool distributeMessage(Message* message);
 
+	void handlePing(Message* message);
+	void handleExit(Message* message);
+	void handleAcquisitionStart(Message* message);
+	void handleAcquisitionStop(Message* message);
+	void handleGetDeviceDescription(Message* message);
+	void handleGetErrorMessage(Message* message);
+	void handleSetSource(Message* message);
+	void handleAddSink(Message* message);
+	void handleRemoveSink(Message* message);
+	void handleAddAudioSource(Message* message);
+	void handleRemoveAudioSource(Message* message);
+	void handleConfigureAudioOutput(Message* message);
+	void handleConfigureCorrection(Message* message);
+	void handleConfigurePipeline(Message* message);
+
+	friend class DSPPipeline;
+
 private slots:
 	void handleData();
 	void handleMessages();
@@ -0,0 +1,115 @@
+#ifndef INCLUDE_DSPPIPELINE_H
+#define INCLUDE_DSPPIPELINE_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <QList>
+#include "dsp/dsptypes.h"
+#include "util/spinlock.h"
+#include "util/export.h"
+
+class DSPEngine;
+
+// Pipelined mode of the DSPEngine. The engine thread only copies blocks out of the source fifo;
+// correction, channel fan-out and the main spectrum each run on a thread of their own:
+//
+//   engine -> correction -+-> fan-out (all sinks but the main spectrum)
+//                         +-> spectrum (main spectrum sink)
+//
+// The stages are connected by SPSC queues of blocks. All blocks come from a fixed pool, so the
+// pipeline holds at most NumBlocks blocks; when it is full the data waits in the source fifo.
+class SDRANGELOVE_API DSPPipeline {
+public:
+	enum {
+		BlockSize = 16384,
+		NumBlocks = 32
+	};
+
+	struct Block {
+		SampleVector m_samples;
+		uint m_count;
+		bool m_firstOfBurst;
+		qint64 m_origin; // latency origin of the samples, 0 if not measured
+		qint64 m_read;   // when the engine took the block from the source fifo
+		QAtomicInt m_refs;
+
+		Block() :
+			m_samples(BlockSize),
+			m_count(0),
+			m_firstOfBurst(false),
+			m_origin(0),
+			m_read(0),
+			m_refs(0)
+		{ }
+	};
+
+	DSPPipeline(DSPEngine* engine);
+	~DSPPipeline();
+
+	// called from the engine thread only
+	void start();
+	void stop();
+	bool isRunning() const { return !m_stages.isEmpty(); }
+
+	// NULL if all blocks are in flight
+	Block* acquireBlock();
+	void push(Block* block);
+	// sleeps until every block has passed all stages - the engine calls this before it touches
+	// the sink list, the correction state or a sink the stages feed directly
+	void drain();
+
+private:
+	enum StageType {
+		StCorrection,
+		StFanOut,
+		StSpectrum
+	};
+
+	class Queue {
+	public:
+		Queue();
+
+		void push(Block* block);
+		// blocks until there is something, NULL tells the stage to quit
+		Block* pop();
+
+	private:
+		QSemaphore m_available;
+		Block* m_ring[NumBlocks];
+		int m_head; // consumer only
+		int m_tail; // producer only
+	};
+
+	class Stage : public QThread {
+	public:
+		Stage(DSPPipeline* pipeline, StageType type, Queue* input);
+
+	protected:
+		void run();
+
+	private:
+		DSPPipeline* m_pipeline;
+		StageType m_type;
+		Queue* m_input;
+	};
+
+	DSPEngine* m_engine;
+
+	Block m_blocks[NumBlocks];
+	Spinlock m_freeLock;
+	SpinlockMetrics m_freeLockMetrics;
+	QList<Block*> m_free;
+	bool m_draining; // guarded by m_freeLock
+	QSemaphore m_drained; // released by the stage which returns the last block in flight
+
+	Queue m_correctionQueue;
+	Queue m_fanOutQueue;
+	Queue m_spectrumQueue;
+	QList<Stage*> m_stages;
+
+	void process(StageType type, Block* block);
+	void release(Block* block);
+};
+
+#endif // INCLUDE_DSPPIPELINE_H
@@ -39,6 +39,8 @@ public:
 	void apply(const std::vector<Real>& in, std::vector<Real>* out);
 	void apply(const std::vector<Complex>& in, std::vector<Complex>* out);
 	void apply(const Complex* in, Complex* out);
+	// apply to a ring buffer of window size whose oldest sample is at index start
+	void apply(const Complex* ring, size_t start, Complex* out);
 
 private:
 	std::vector<float> m_window;
@@ -15,6 +15,7 @@ public:
 	PIDController();
 
 	void setup(Real p, Real i, Real d);
+	void reset() { m_int = 0.0; m_diff = 0.0; }
 
 	Real feed(Real v)
 	{
@@ -12,12 +12,17 @@ public:
 	enum TriggerChannel {
 		TriggerFreeRun,
 		TriggerChannelI,
-		TriggerChannelQ
+		TriggerChannelQ,
+		TriggerMagnitude,
+		TriggerPhaseStep
 	};
 
 	ScopeVis(GLScope* glScope = NULL);
 
-	void configure(MessageQueue* msgQueue, TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow);
+	// trigger levels are relative to full scale (phase step: relative to pi),
+	// triggerPre is the part of the trace recorded before the trigger in percent
+	void configure(MessageQueue* msgQueue, TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow,
+		int traceSize = 100000, int triggerPre = 0);
 
 	void feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst);
 	void start();
@@ -33,12 +38,28 @@ private:
 
 	GLScope* m_glScope;
 	std::vector<Complex> m_trace;
+	uint m_traceSize;
 	uint m_fill;
 	TriggerState m_triggerState;
 	TriggerChannel m_triggerChannel;
-	FixReal m_triggerLevelHigh;
-	FixReal m_triggerLevelLow;
+	qint32 m_triggerLevelHigh;
+	qint32 m_triggerLevelLow;
+	Real m_triggerCosHigh;
+	Real m_triggerCosLow;
+	Sample m_lastSample;
 	int m_sampleRate;
+	bool m_paused; // the engine is shedding load
+
+	// pre-trigger history
+	SampleVector m_preTrigger;
+	uint m_preTriggerPos;
+	uint m_preTriggerFill;
+
+	int findLevel(SampleVector::const_iterator begin, int count, bool high);
+	int findPhaseStep(SampleVector::const_iterator begin, int count, bool high);
+	void storePreTrigger(SampleVector::const_iterator begin, int count);
+	void startTrace();
+	void restartCapture();
 };
 
 #endif // INCLUDE_SCOPEVIS_H
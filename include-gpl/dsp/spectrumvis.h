@@ -1,6 +1,7 @@
 #ifndef INCLUDE_SPECTRUMVIS_H
 #define INCLUDE_SPECTRUMVIS_H
 
+#include <QElapsedTimer>
 #include "dsp/samplesink.h"
 #include "dsp/fftengine.h"
 #include "fftwindow.h"
@@ -11,10 +12,18 @@ class MessageQueue;
 
 class SDRANGELOVE_API SpectrumVis : public SampleSink {
 public:
+	enum AveragingMode {
+		AvgNone, // pass on the most recent frame
+		AvgLinear, // linear power average over all frames of one output period
+		AvgPeakHold, // maximum power per bin over one output period
+		AvgMinHold // minimum power per bin over one output period
+	};
+
 	SpectrumVis(GLSpectrum* glSpectrum = NULL);
 	~SpectrumVis();
 
-	void configure(MessageQueue* msgQueue, int fftSize, int overlapPercent, FFTWindow::Function window);
+	void configure(MessageQueue* msgQueue, int fftSize, int overlapPercent, FFTWindow::Function window,
+		AveragingMode averagingMode = AvgNone, int frameRate = 0);
 
 	void feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst);
 	void start();
@@ -26,6 +35,7 @@ private:
 	FFTWindow m_window;
 
 	std::vector<Complex> m_fftBuffer;
+	std::vector<Real> m_powerSpectrum;
 	std::vector<Real> m_logPowerSpectrum;
 
 	size_t m_fftSize;
@@ -33,10 +43,24 @@ private:
 	size_t m_overlapSize;
 	size_t m_refillSize;
 	size_t m_fftBufferFill;
+	size_t m_fftBufferPos;
+
+	AveragingMode m_averagingMode;
+	int m_averagingCount;
+	int m_frameRate;
+	qint64 m_frameInterval;
+	qint64 m_nextFrame;
+	QElapsedTimer m_frameTimer;
+	bool m_shedding; // the engine is overloaded: no overlap, fewer frames
 
 	GLSpectrum* m_glSpectrum;
 
-	void handleConfigure(int fftSize, int overlapPercent, FFTWindow::Function window);
+	void write(SampleVector::const_iterator begin, size_t count);
+	void accumulate(const Complex* fftOut);
+	void output();
+	void applyRates();
+
+	void handleConfigure(int fftSize, int overlapPercent, FFTWindow::Function window, AveragingMode averagingMode, int frameRate);
 };
 
 #endif // INCLUDE_SPECTRUMVIS_H
@@ -6,6 +6,7 @@
 class QBoxLayout;
 class QSpacerItem;
 class RollupWidget;
+class SinkProfileWidget;
 
 class ChannelWindow : public QScrollArea {
 	Q_OBJECT
@@ -18,6 +19,8 @@ public:
 protected:
 	QWidget* m_container;
 	QBoxLayout* m_layout;
+	// below the channels, only shown while sink profiling is on
+	SinkProfileWidget* m_profileWidget;
 
 	void resizeEvent(QResizeEvent* event);
 };
@@ -50,19 +50,24 @@ public:
 	void setTimeOfsProMill(int timeOfsProMill);
 	void setMode(Mode mode);
 	void setOrientation(Qt::Orientation orientation);
+	void setTrigger(ScopeVis::TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow, int traceSize, int triggerPre);
 
-	void newTrace(const std::vector<Complex>& trace, int sampleRate);
+	// swaps trace with the currently displayed buffer - the caller gets the previous buffer back
+	void newTrace(std::vector<Complex>& trace, int sampleRate);
 
 	int getTraceSize() const { return m_rawTrace.size(); }
 
 signals:
 	void traceSizeChanged(int);
+	// trigger channel and level in percent of full scale picked with the mouse
+	void triggerPicked(int channel, int level);
 
 private:
 	// state
 	QTimer m_timer;
 	QMutex m_mutex;
 	bool m_dataChanged;
+	bool m_mathChanged;
 	bool m_configChanged;
 	Mode m_mode;
 	Qt::Orientation m_orientation;
@@ -89,6 +94,8 @@ private:
 	ScopeVis::TriggerChannel m_triggerChannel;
 	Real m_triggerLevelHigh;
 	Real m_triggerLevelLow;
+	int m_traceSize;
+	int m_triggerPre;
 
 	// graphics stuff
 	QRectF m_glScopeRect1;
@@ -101,6 +108,7 @@ private:
 	void mousePressEvent(QMouseEvent*);
 
 	void handleMode();
+	void drawTrace(int start, int end, bool imag, Real ofs, Real amp, int pixels);
 	void applyConfig();
 
 protected slots:
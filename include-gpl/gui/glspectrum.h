@@ -21,10 +21,12 @@
 #include <QGLWidget>
 #include <QTimer>
 #include <QMutex>
+#include <QAtomicInt>
 #include "dsp/dsptypes.h"
 #include "gui/scaleengine.h"
 #include "dsp/channelmarker.h"
 #include "util/export.h"
+#include "util/triplebuffer.h"
 
 class SDRANGELOVE_API GLSpectrum : public QGLWidget {
 	Q_OBJECT
@@ -48,6 +50,12 @@ public:
 	void removeChannelMarker(ChannelMarker* channelMarker);
 
 	void newSpectrum(const std::vector<Real>& spectrum, int fftSize);
+	// read by the SpectrumVis worker thread
+	int getDisplayWidth() const { return m_displayWidth.loadAcquire(); }
+
+	int getFramesProduced() const { return m_spectrumMailbox.getProduced(); }
+	int getFramesConsumed() const { return m_spectrumMailbox.getConsumed(); }
+	int getFramesSkipped() const { return m_spectrumMailbox.getSkipped(); }
 
 private:
 	struct ChannelMarkerState {
@@ -70,6 +78,18 @@ private:
 		CSChannelMoving
 	};
 
+	struct SpectrumFrame {
+		std::vector<Real> m_spectrum;
+		int m_fftSize;
+
+		SpectrumFrame() :
+			m_spectrum(),
+			m_fftSize(0)
+		{ }
+	};
+	// written by the spectrum thread, read by the GUI thread in paintGL()
+	TripleBuffer<SpectrumFrame> m_spectrumMailbox;
+
 	CursorState m_cursorState;
 	int m_cursorChannel;
 
@@ -85,6 +105,7 @@ private:
 	quint32 m_sampleRate;
 
 	int m_fftSize;
+	QAtomicInt m_displayWidth; // written by applyChanges() on the GUI thread
 
 	bool m_displayGrid;
 	bool m_invertedWaterfall;
@@ -45,6 +45,8 @@ private:
 	bool m_displayHistogram;
 	bool m_displayGrid;
 	bool m_invert;
+	qint32 m_averagingMode;
+	qint32 m_frameRate;
 
 	void applySettings();
 
@@ -54,6 +56,8 @@ private slots:
 	void on_refLevel_currentIndexChanged(int index);
 	void on_levelRange_currentIndexChanged(int index);
 	void on_decay_currentIndexChanged(int index);
+	void on_averaging_currentIndexChanged(int index);
+	void on_frameRate_currentIndexChanged(int index);
 
 	void on_waterfall_toggled(bool checked);
 	void on_histogram_toggled(bool checked);
@@ -0,0 +1,29 @@
+#ifndef INCLUDE_LATENCYDIALOG_H
+#define INCLUDE_LATENCYDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+
+namespace Ui {
+	class LatencyDialog;
+}
+
+class LatencyDialog : public QDialog {
+	Q_OBJECT
+
+public:
+	explicit LatencyDialog(QWidget* parent = NULL);
+	~LatencyDialog();
+
+private:
+	Ui::LatencyDialog* ui;
+	QTimer m_updateTimer;
+
+private slots:
+	void updateTable();
+	void on_enable_toggled(bool checked);
+	void on_reset_clicked();
+	void on_dump_clicked();
+};
+
+#endif // INCLUDE_LATENCYDIALOG_H
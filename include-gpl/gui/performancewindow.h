@@ -0,0 +1,42 @@
+#ifndef INCLUDE_PERFORMANCEWINDOW_H
+#define INCLUDE_PERFORMANCEWINDOW_H
+
+#include <QWidget>
+#include <QTimer>
+#include <QMap>
+#include <QElapsedTimer>
+#include "util/export.h"
+
+class QTreeWidget;
+class QTreeWidgetItem;
+
+// Contents of the "Performance" dock: every metric of the registry with its current value and,
+// for counters, the rate since the last update. Only updates while it is visible.
+class SDRANGELOVE_API PerformanceWindow : public QWidget {
+	Q_OBJECT
+
+public:
+	PerformanceWindow(QWidget* parent = NULL);
+
+protected:
+	void showEvent(QShowEvent* event);
+	void hideEvent(QHideEvent* event);
+
+private:
+	struct Row {
+		QTreeWidgetItem* m_item;
+		double m_lastValue;
+		bool m_seen;
+	};
+	typedef QMap<QString, Row> Rows;
+
+	QTreeWidget* m_tree;
+	QTimer m_updateTimer;
+	QElapsedTimer m_interval;
+	Rows m_rows;
+
+private slots:
+	void updateTable();
+};
+
+#endif // INCLUDE_PERFORMANCEWINDOW_H
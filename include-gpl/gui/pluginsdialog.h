@@ -17,6 +17,10 @@ public:
 
 private:
 	Ui::PluginsDialog* ui;
+
+private slots:
+	void on_profileEnable_toggled(bool checked);
+	void on_profileReset_clicked();
 };
 
 #endif // INCLUDE_PLUGINSDIALOG_H
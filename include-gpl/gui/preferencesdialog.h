@@ -2,6 +2,12 @@
 #define INCLUDE_PREFERENCESDIALOG_H
 
 #include <QDialog>
+#include "util/threadpolicy.h"
+
+class QLineEdit;
+class QComboBox;
+class QSpinBox;
+class QTreeWidgetItem;
 
 class Preferences;
 
@@ -21,8 +27,13 @@ private:
 
 	Preferences* m_preferences;
 
+	QLineEdit* m_threadCpus[ThreadPolicy::TcCount];
+	QComboBox* m_threadScheduling[ThreadPolicy::TcCount];
+	QSpinBox* m_threadPriority[ThreadPolicy::TcCount];
+
 private slots:
 	void accept();
+	void on_configTree_currentItemChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous);
 };
 
 #endif // INCLUDE_PREFERENCESDIALOG_H
@@ -45,9 +45,14 @@ public:
 private slots:
 	void on_amp_valueChanged(int value);
 	void on_scope_traceSizeChanged(int value);
+	void on_scope_triggerPicked(int channel, int level);
 	void on_time_valueChanged(int value);
 	void on_timeOfs_valueChanged(int value);
 	void on_displayMode_currentIndexChanged(int index);
+	void on_trigger_currentIndexChanged(int index);
+	void on_triggerLevel_valueChanged(int value);
+	void on_triggerPre_valueChanged(int value);
+	void on_traceLength_currentIndexChanged(int index);
 
 	void on_horizView_clicked();
 	void on_vertView_clicked();
@@ -61,8 +66,13 @@ private:
 	qint32 m_timeBase;
 	qint32 m_timeOffset;
 	qint32 m_amplification;
+	qint32 m_triggerChannel;
+	qint32 m_triggerLevel;
+	qint32 m_triggerPre;
+	qint32 m_traceLength;
 
 	void applySettings();
+	void applyTrigger();
 };
 
 #endif // INCLUDE_SCOPEWINDOW_H
@@ -0,0 +1,26 @@
+#ifndef INCLUDE_SINKPROFILEWIDGET_H
+#define INCLUDE_SINKPROFILEWIDGET_H
+
+#include <QTreeWidget>
+#include <QTimer>
+#include "util/export.h"
+
+// Table of the named sink profiles (see SinkProfile), one row per channel instance and stage.
+// Updates every second while visible. With autoHide it only shows itself while profiling is on.
+class SDRANGELOVE_API SinkProfileWidget : public QTreeWidget {
+	Q_OBJECT
+
+public:
+	SinkProfileWidget(QWidget* parent = NULL);
+
+	void setAutoHide(bool autoHide);
+
+private:
+	QTimer m_updateTimer;
+	bool m_autoHide;
+
+private slots:
+	void updateTable();
+};
+
+#endif // INCLUDE_SINKPROFILEWIDGET_H
@@ -30,7 +30,9 @@ class QDir;
 class DSPEngine;
 class Indicator;
 class ScopeWindow;
+class LatencyDialog;
 class SpectrumVis;
+class ThreadedSampleSink;
 class SampleSource;
 class PluginAPI;
 class PluginGUI;
@@ -74,6 +76,7 @@ private:
 	Settings m_settings;
 
 	SpectrumVis* m_spectrumVis;
+	ThreadedSampleSink* m_spectrumVisThread;
 
 	DSPEngine* m_dspEngine;
 
@@ -81,13 +84,17 @@ private:
 	int m_lastEngineState;
 
 	QLabel* m_sampleRateWidget;
+	QLabel* m_engineLag;
 	Indicator* m_engineIdle;
 	Indicator* m_engineRunning;
 	Indicator* m_engineError;
+	Indicator* m_engineOverload;
+	int m_lastOverloadLevel;
 
 	bool m_startOsmoSDRUpdateAfterStop;
 
 	ScopeWindow* m_scopeWindow;
+	LatencyDialog* m_latencyDialog;
 	QWidget* m_inputGUI;
 
 	int m_sampleRate;
@@ -96,6 +103,7 @@ private:
 	PluginManager* m_pluginManager;
 
 	void loadSettings();
+	void applyThreadPolicies();
 	void loadSettings(const Preset* preset);
 	void saveSettings(Preset* preset);
 	void saveSettings();
@@ -125,6 +133,8 @@ private slots:
 	void on_presetTree_currentItemChanged(QTreeWidgetItem *current, QTreeWidgetItem *previous);
 	void on_presetTree_itemActivated(QTreeWidgetItem *item, int column);
 	void on_action_Oscilloscope_triggered();
+	void on_action_Latency_Statistics_triggered();
+	void on_action_Dump_Trace_triggered();
 	void on_action_Loaded_Plugins_triggered();
 	void on_action_Preferences_triggered();
 	void on_sampleSource_currentIndexChanged(int index);
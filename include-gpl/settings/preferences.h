@@ -2,6 +2,7 @@
 #define INCLUDE_PREFERENCES_H
 
 #include <QString>
+#include "util/threadpolicy.h"
 
 class Preferences {
 public:
@@ -17,9 +18,21 @@ public:
 	void setAudioOutputRate(quint32 value) { m_audioOutputRate = value; }
 	uint getAudioOutputRate() const { return m_audioOutputRate; }
 
+	void setPipelinedEngine(bool value) { m_pipelinedEngine = value; }
+	bool getPipelinedEngine() const { return m_pipelinedEngine; }
+
+	void setPooledChannelSinks(bool value) { m_pooledChannelSinks = value; }
+	bool getPooledChannelSinks() const { return m_pooledChannelSinks; }
+
+	void setThreadPolicy(ThreadPolicy::ThreadClass threadClass, const ThreadPolicy::Config& value) { m_threadPolicies[threadClass] = value; }
+	const ThreadPolicy::Config& getThreadPolicy(ThreadPolicy::ThreadClass threadClass) const { return m_threadPolicies[threadClass]; }
+
 protected:
 	QString m_audioOutput;
 	uint m_audioOutputRate;
+	bool m_pipelinedEngine;
+	bool m_pooledChannelSinks;
+	ThreadPolicy::Config m_threadPolicies[ThreadPolicy::TcCount];
 };
 
 #endif // INCLUDE_PREFERENCES_H
@@ -0,0 +1,24 @@
+#ifndef INCLUDE_DECOUPLEDSAMPLESINK_H
+#define INCLUDE_DECOUPLEDSAMPLESINK_H
+
+#include "dsp/samplesink.h"
+#include "util/export.h"
+
+class MessageQueue;
+
+// Wrapper which hands the samples of a channel chain over to another thread: ThreadedSampleSink
+// owns one, PooledSampleSink runs on the engine's SinkWorkerPool. Channels get theirs from
+// DSPEngine::createChannelSink() and only use this interface, so the kind is a preference.
+class SDRANGELOVE_API DecoupledSampleSink : public SampleSink {
+public:
+	// messages for the wrapped sink go here
+	virtual MessageQueue* getMessageQueue() = 0;
+
+	// labels the metrics of the sink, its fifo and its message queue and names the profiles
+	// of the hand-off and of the wrapped sink
+	virtual void setMetricsName(const QString& name) = 0;
+
+	bool queuesMessages() const { return true; }
+};
+
+#endif // INCLUDE_DECOUPLEDSAMPLESINK_H
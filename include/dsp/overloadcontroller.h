@@ -0,0 +1,49 @@
+#ifndef INCLUDE_OVERLOADCONTROLLER_H
+#define INCLUDE_OVERLOADCONTROLLER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "util/export.h"
+
+// Decides how much work the engine sheds when it cannot keep up. It watches the fill of the
+// source fifo and the load of the engine and steps through the levels one at a time: up after
+// StepUpMs of overload, down after StepDownMs of headroom. The sinks are told the level with a
+// DSPOverloadNotification and each gives up its share; only the last level loses samples.
+class SDRANGELOVE_API OverloadController {
+public:
+	enum Level {
+		OlNone,
+		OlReduceSpectrum, // lower spectrum/waterfall frame rate, no FFT overlap
+		OlPauseScope, // the scopes stop capturing
+		OlDropSamples, // the engine skips backlog at quantum boundaries
+		OlCount
+	};
+
+	OverloadController();
+
+	void reset();
+	// fill and size of the source fifo, load in per mille of realtime - true if the level changed
+	bool update(uint fill, uint size, int load);
+
+	// may be read from any thread
+	Level getLevel() const { return (Level)m_level.loadAcquire(); }
+	static const char* levelName(Level level);
+
+private:
+	enum {
+		StepUpMs = 500,
+		StepDownMs = 3000,
+		OverloadFill = 50, // percent of the fifo
+		RelaxedFill = 10,
+		OverloadLoad = 950, // per mille of realtime
+		RelaxedLoad = 700
+	};
+
+	QAtomicInt m_level;
+	QElapsedTimer m_overloadTimer; // running while overloaded
+	QElapsedTimer m_relaxedTimer; // running while there is headroom
+	bool m_overloaded;
+	bool m_relaxed;
+};
+
+#endif // INCLUDE_OVERLOADCONTROLLER_H
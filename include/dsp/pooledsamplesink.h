@@ -0,0 +1,60 @@
+#ifndef INCLUDE_POOLEDSAMPLESINK_H
+#define INCLUDE_POOLEDSAMPLESINK_H
+
+#include <QMutex>
+#include "dsp/decoupledsamplesink.h"
+#include "dsp/samplefifo.h"
+#include "dsp/sinkworkerpool.h"
+#include "util/messagequeue.h"
+#include "util/export.h"
+
+// Same interface as ThreadedSampleSink, but instead of owning a thread the sink is a task of the
+// engine's SinkWorkerPool. Data and messages are handled in order by one worker at a time.
+class SDRANGELOVE_API PooledSampleSink : public DecoupledSampleSink, public SinkWorkerPool::Task {
+	Q_OBJECT
+
+public:
+	PooledSampleSink(SinkWorkerPool* pool, SampleSink* sampleSink, bool dropOldest = false);
+	virtual ~PooledSampleSink();
+
+	MessageQueue* getMessageQueue() { return &m_messageQueue; }
+
+	void feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst);
+	void start();
+	void stop();
+	bool handleMessage(Message* cmd);
+
+	void setMetricsName(const QString& name);
+
+	void run();
+
+protected:
+	// held while the sink is worked on, start() and stop() wait for the worker
+	QMutex m_mutex;
+	SinkWorkerPool* m_pool;
+	MessageQueue m_messageQueue;
+	SampleFifo m_sampleFifo;
+	SampleSink* m_sampleSink;
+	Metric m_feedTimeMetric;
+	Metric m_samplesMetric;
+
+	// who owns the sink right now; a worker only touches the sink while it is in StRunning or
+	// StRerun, leaving those states is the last thing run() does
+	enum State {
+		StIdle,     // not queued, nothing to do
+		StQueued,   // in a queue of the pool
+		StRunning,  // a worker is in run()
+		StRerun,    // a worker is in run() and more arrived meanwhile
+		StDetached  // the destructor took over, never scheduled again
+	};
+	QAtomicInt m_state;
+	QAtomicInt m_running;
+
+	void schedule();
+	void handleData();
+
+protected slots:
+	void handleMessages();
+};
+
+#endif // INCLUDE_POOLEDSAMPLESINK_H
@@ -0,0 +1,59 @@
+#ifndef INCLUDE_QUANTUMSCHEDULER_H
+#define INCLUDE_QUANTUMSCHEDULER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include "util/export.h"
+
+// Splits the work of a fifo reader into quanta of a fixed signal duration. Between two quanta
+// the reader looks at its message queue, so a control message waits for one quantum at most,
+// and it gives the event loop a turn once the time budget of a burst is used up.
+//
+// Every quantum has a deadline: it has to be done within the time its samples last, otherwise
+// the reader falls behind. The scheduler counts missed deadlines and keeps the time the reader
+// is behind realtime (the backlog in its fifo) and the load (processing time / signal time).
+class SDRANGELOVE_API QuantumScheduler {
+public:
+	QuantumScheduler(int quantumUs = 5000, int budgetUs = 20000);
+
+	void setSampleRate(uint sampleRate);
+	uint getSampleRate() const { return m_sampleRate; }
+
+	// samples in one quantum, a fixed count as long as the sample rate is not known
+	uint quantumSize() const { return m_quantumSize; }
+
+	void beginBurst();
+	bool budgetExhausted() const;
+
+	void beginQuantum();
+	// count samples were processed, backlog samples are still waiting in the fifo
+	void endQuantum(uint count, uint backlog);
+
+	// statistics, may be read from any thread
+	int getLagUs() const { return m_lagUs.loadAcquire(); }
+	int getLoad() const { return m_load.loadAcquire(); } // per mille of realtime, smoothed
+	int getMissedDeadlines() const { return m_missedDeadlines.loadAcquire(); }
+	int getQuanta() const { return m_quanta.loadAcquire(); }
+	void resetStats();
+
+private:
+	enum {
+		DefaultQuantumSize = 4096
+	};
+
+	int m_quantumUs;
+	int m_budgetUs;
+	uint m_sampleRate;
+	uint m_quantumSize;
+
+	QElapsedTimer m_burstTimer;
+	QElapsedTimer m_quantumTimer;
+	double m_loadAverage;
+
+	QAtomicInt m_lagUs;
+	QAtomicInt m_load;
+	QAtomicInt m_missedDeadlines;
+	QAtomicInt m_quanta;
+};
+
+#endif // INCLUDE_QUANTUMSCHEDULER_H
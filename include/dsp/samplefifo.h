@@ -22,6 +22,8 @@
 #include <QMutex>
 #include <QTime>
 #include "dsp/dsptypes.h"
+#include "util/latency.h"
+#include "util/metrics.h"
 #include "util/export.h"
 
 class SDRANGELOVE_API SampleFifo : public QObject {
@@ -38,8 +40,45 @@ private:
 	uint m_fill;
 	uint m_head;
 	uint m_tail;
+	uint m_readPending;
+
+	bool m_dropOldest;
+
+	// latency measurement: where every written block starts and when it was written
+	struct Marker {
+		quint64 m_begin;
+		quint64 m_end;
+		qint64 m_written;
+		qint64 m_origin;
+	};
+	enum {
+		MaxMarkers = 64
+	};
+	Marker m_markers[MaxMarkers];
+	uint m_markerHead;
+	uint m_markerCount;
+	quint64 m_writeCount;
+	Latency::Stage m_latencyStage;
+
+	// gaps in the stream: positions with dropped samples in front of them, reads never cross one
+	enum {
+		MaxGaps = 16
+	};
+	quint64 m_gaps[MaxGaps];
+	uint m_gapHead;
+	uint m_gapCount;
+	bool m_gapAtHead; // skip() dropped the samples in front of the read position
+	bool m_readAfterGap;
+	quint64 m_dropped;
+
+	Metric m_fillMetric;
+	Metric m_overflowsMetric;
+	Metric m_droppedMetric;
 
 	void create(uint s);
+	void pushMarker(uint count);
+	void popMarker();
+	void pushGap(quint64 pos);
 
 public:
 	SampleFifo(QObject* parent = NULL);
@@ -47,7 +86,21 @@ public:
 	~SampleFifo();
 
 	bool setSize(int size);
+	void setDropOldest(bool dropOldest) { m_dropOldest = dropOldest; }
+	void setLatencyStage(Latency::Stage stage) { m_latencyStage = stage; }
+	void setMetricsName(const QString& name);
 	inline uint fill() const { return m_fill; }
+	inline uint size() const { return m_size; }
+	// samples thrown away so far, by overflows and skip()
+	quint64 getDropped() const { return m_dropped; }
+
+	// the next written sample does not continue the previous one
+	void markGap();
+	// drops count samples at the read position, the next read starts after a gap - only between
+	// readCommit() and the next readBegin()
+	uint skip(uint count);
+	// true if the data returned by the last readBegin() does not continue the data read before
+	bool readAfterGap() const { return m_readAfterGap; }
 
 	uint write(const quint8* data, uint count);
 	uint write(SampleVector::const_iterator begin, SampleVector::const_iterator end);
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include "dsptypes.h"
+#include "dsp/sinkprofile.h"
 #include "util/export.h"
 
 class Message;
@@ -12,10 +13,26 @@ public:
 	SampleSink();
 	virtual ~SampleSink();
 
+	// firstOfBurst: the block does not continue the previous one, samples were dropped in between
 	virtual void feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst) = 0;
 	virtual void start() = 0;
 	virtual void stop() = 0;
 	virtual bool handleMessage(Message* cmd) = 0;
+	// true if handleMessage() only queues the message for a thread of the sink's own, then the
+	// engine may hand it over while the pipeline still feeds the sink
+	virtual bool queuesMessages() const { return false; }
+
+	// feed() with the call recorded in the profile of this sink if profiling is on
+	void profiledFeed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
+	{
+		qint64 start = m_profile.begin();
+		feed(begin, end, firstOfBurst);
+		m_profile.end(start, end - begin);
+	}
+	SinkProfile* getProfile() { return &m_profile; }
+
+protected:
+	SinkProfile m_profile;
 };
 
 #endif // INCLUDE_SAMPLESINK_H
@@ -0,0 +1,71 @@
+#ifndef INCLUDE_SINKPROFILE_H
+#define INCLUDE_SINKPROFILE_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <QList>
+#include "util/spinlock.h"
+#include "util/export.h"
+
+// Optional profile of SampleSink::feed() of one sink: calls, samples in and out, total and
+// maximum time. Every sink carries one, the caller of feed() records into it (see
+// SampleSink::profiledFeed()). The counters are guarded by a spinlock which only collect() and
+// resetAll() contend for, about once a second. Only named profiles show up in collect().
+class SDRANGELOVE_API SinkProfile {
+public:
+	struct Snapshot {
+		QString m_name;
+		QString m_stage;
+		qint64 m_calls;
+		qint64 m_samplesIn;
+		qint64 m_samplesOut;
+		qint64 m_totalNs;
+		qint64 m_maxNs;
+	};
+	typedef QList<Snapshot> Snapshots;
+
+	SinkProfile();
+	~SinkProfile();
+
+	static bool isEnabled() { return m_enabled.loadAcquire() != 0; }
+	static void setEnabled(bool enabled);
+
+	// monotonic clock in nanoseconds
+	static qint64 now();
+
+	// name is the channel instance, stage tells the profiles of one instance apart
+	void setName(const QString& name, const QString& stage);
+
+	// returns 0 if profiling is off, end() ignores the call then
+	qint64 begin() const { return isEnabled() ? now() : 0; }
+	void end(qint64 start, qint64 samples);
+	// sinks which pass samples on count them here for the input/output ratio
+	void addOutput(qint64 samples)
+	{
+		if(isEnabled()) {
+			SpinlockHolder spinlockHolder(&m_lock);
+			m_samplesOut += samples;
+		}
+	}
+
+	// sorted by name and stage
+	static Snapshots collect();
+	static void resetAll();
+
+private:
+	static QAtomicInt m_enabled;
+
+	QString m_name;
+	QString m_stage;
+	bool m_registered;
+
+	Spinlock m_lock;
+	SpinlockMetrics* m_lockMetrics; // only named profiles have one
+	qint64 m_calls;
+	qint64 m_samplesIn;
+	qint64 m_samplesOut;
+	qint64 m_totalNs;
+	qint64 m_maxNs;
+};
+
+#endif // INCLUDE_SINKPROFILE_H
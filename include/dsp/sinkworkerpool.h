@@ -0,0 +1,81 @@
+#ifndef INCLUDE_SINKWORKERPOOL_H
+#define INCLUDE_SINKWORKERPOOL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QAtomicInt>
+#include "util/export.h"
+
+// Small set of threads, one per core, that runs the channel chains of all PooledSampleSinks.
+// Every worker has its own queue. A task goes back to the worker that ran it last so its filter
+// state stays in that core's cache, and a worker that runs out of tasks steals from the others.
+class SDRANGELOVE_API SinkWorkerPool {
+public:
+	class Task {
+	public:
+		Task() : m_lastWorker(-1) { }
+		virtual ~Task() { }
+
+		// called by one worker at a time, the pool never runs the same task concurrently
+		virtual void run() = 0;
+
+	private:
+		int m_lastWorker;
+
+		friend class SinkWorkerPool;
+	};
+
+	SinkWorkerPool();
+	~SinkWorkerPool();
+
+	// numThreads = 0 starts one worker per core
+	void start(int numThreads = 0);
+	void stop();
+
+	// the caller makes sure a task is queued at most once, false if the pool was never started
+	bool schedule(Task* task);
+	// removes a queued task, false if it is not queued (any more)
+	bool cancel(Task* task);
+
+	int getThreadCount() const { return m_workers.count(); }
+	int getTasksRun() const { return m_tasksRun.loadAcquire(); }
+	int getSteals() const { return m_steals.loadAcquire(); }
+
+private:
+	class Worker : public QThread {
+	public:
+		Worker(SinkWorkerPool* pool, int index);
+
+	protected:
+		void run();
+
+	private:
+		SinkWorkerPool* m_pool;
+		int m_index;
+	};
+
+	struct Queue {
+		QMutex m_mutex;
+		QList<Task*> m_tasks;
+	};
+
+	QList<Worker*> m_workers;
+	QList<Queue*> m_queues;
+
+	QAtomicInt m_stopping;
+	QAtomicInt m_pending;
+	QAtomicInt m_idle;
+	QAtomicInt m_nextQueue;
+	QMutex m_idleMutex;
+	QWaitCondition m_idleCondition;
+
+	QAtomicInt m_tasksRun;
+	QAtomicInt m_steals;
+
+	Task* takeTask(int index);
+	void waitForTask();
+};
+
+#endif // INCLUDE_SINKWORKERPOOL_H
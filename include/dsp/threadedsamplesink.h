@@ -2,19 +2,20 @@
 #define INCLUDE_THREADEDSAMPLESINK_H
 
 #include <QMutex>
-#include "samplesink.h"
+#include "dsp/decoupledsamplesink.h"
 #include "dsp/samplefifo.h"
+#include "dsp/quantumscheduler.h"
 #include "util/messagequeue.h"
 #include "util/export.h"
 
 class QThread;
 class SampleSink;
 
-class SDRANGELOVE_API ThreadedSampleSink : public SampleSink {
+class SDRANGELOVE_API ThreadedSampleSink : public DecoupledSampleSink {
 	Q_OBJECT
 
 public:
-	ThreadedSampleSink(SampleSink* sampleSink);
+	ThreadedSampleSink(SampleSink* sampleSink, bool dropOldest = false);
 	virtual ~ThreadedSampleSink();
 
 	MessageQueue* getMessageQueue() { return &m_messageQueue; }
@@ -24,12 +25,19 @@ public:
 	void stop();
 	bool handleMessage(Message* cmd);
 
+	void setMetricsName(const QString& name);
+
+	const QuantumScheduler* getScheduler() const { return &m_scheduler; }
+
 protected:
 	QMutex m_mutex;
 	QThread* m_thread;
 	MessageQueue m_messageQueue;
 	SampleFifo m_sampleFifo;
 	SampleSink* m_sampleSink;
+	Metric m_feedTimeMetric;
+	Metric m_samplesMetric;
+	QuantumScheduler m_scheduler;
 
 protected slots:
 	void handleData();
@@ -11,8 +11,10 @@ class PluginManager;
 class PluginInterface;
 class SampleSource;
 class SampleSink;
+class DecoupledSampleSink;
 class DSPEngine;
 class AudioFifo;
+class SinkWorkerPool;
 class MessageQueue;
 class MainWindow;
 class ChannelMarker;
@@ -41,6 +43,9 @@ public:
 	void addSampleSink(SampleSink* sampleSink);
 	void removeSampleSink(SampleSink* sampleSink);
 	MessageQueue* getDSPEngineMessageQueue();
+	SinkWorkerPool* getSinkWorkerPool();
+	// pooled or threaded, as configured in the preferences - the caller deletes it
+	DecoupledSampleSink* createChannelSink(SampleSink* sampleSink);
 	void addAudioSource(AudioFifo* audioFifo);
 	void removeAudioSource(AudioFifo* audioFifo);
 
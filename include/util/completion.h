@@ -0,0 +1,40 @@
+#ifndef INCLUDE_COMPLETION_H
+#define INCLUDE_COMPLETION_H
+
+#include <QAtomicInt>
+#include "util/export.h"
+
+// One-shot completion: one thread waits, another one signals exactly once. It holds no mutex or
+// wait condition of its own - a blocked waiter sleeps on an object owned by its thread and the
+// completing thread wakes exactly that one directly.
+// A waiter that runs into its timeout abandons the completion, complete() reports that to the
+// signalling side, which then owns whatever object the completion is part of.
+class SDRANGELOVE_API Completion {
+public:
+	Completion();
+
+	void reset();
+	// returns false if the waiter has given up
+	bool complete(int result = 0);
+
+	// returns false if timeoutMs (< 0 waits forever) expired before complete() was called
+	bool wait(int timeoutMs = -1);
+	bool isCompleted() const { return m_state.loadAcquire() == StCompleted; }
+	int getResult() const { return m_result; }
+
+	class Waiter;
+
+private:
+	enum State {
+		StIdle,
+		StWaiting,
+		StCompleted,
+		StAbandoned
+	};
+
+	QAtomicInt m_state;
+	int m_result;
+	Waiter* m_waiter;
+};
+
+#endif // INCLUDE_COMPLETION_H
@@ -0,0 +1,74 @@
+#ifndef INCLUDE_LATENCY_H
+#define INCLUDE_LATENCY_H
+
+#include <QAtomicInt>
+#include "util/export.h"
+
+// Histogram of latencies in microseconds. Buckets are logarithmic with eight steps per octave,
+// so every reported value is within 12.5% of the measured one. add() may be called from any thread.
+class SDRANGELOVE_API LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void add(qint64 us);
+	void reset();
+
+	int count() const { return m_count.loadAcquire(); }
+	qint64 maximum() const { return m_maximum.loadAcquire(); }
+	qint64 percentile(double p) const;
+
+private:
+	enum {
+		SubBits = 3,
+		SubSteps = 1 << SubBits,
+		NumBuckets = SubSteps * (32 - SubBits + 1)
+	};
+
+	QAtomicInt m_buckets[NumBuckets];
+	QAtomicInt m_count;
+	QAtomicInt m_maximum;
+
+	static int bucketIndex(quint32 us);
+	static qint64 bucketLimit(int index);
+};
+
+// Optional measurement of the time a block of samples spends in every stage from the source
+// callback to the audio device. Fifos store the time a block was written and the time the block
+// entered the chain (its origin). The reader of a fifo takes over the origin of the block it is
+// working on, so everything called from there - SampleSink::feed() of channelizers, demodulators
+// and the AudioFifo they write to - can pass it on without changing any interfaces.
+class SDRANGELOVE_API Latency {
+public:
+	enum Stage {
+		StSourceFifo,  // source callback -> DSPEngine
+		StEngine,      // DSPEngine processing one block incl. corrections
+		StSinkFifo,    // DSPEngine -> ThreadedSampleSink thread
+		StChannelizer, // channelizer filter chain
+		StDemod,       // demodulator behind the channelizer
+		StAudioFifo,   // demodulator -> audio device
+		StEndToEnd,    // source callback -> audio device
+		StCount
+	};
+
+	static bool isEnabled() { return m_enabled.loadAcquire() != 0; }
+	static void setEnabled(bool enabled);
+
+	// monotonic clock in microseconds
+	static qint64 now();
+
+	// origin of the block the calling thread is working on, 0 if unknown
+	static qint64 origin();
+	static void setOrigin(qint64 origin);
+
+	static void record(Stage stage, qint64 us);
+	static const LatencyHistogram& histogram(Stage stage) { return m_histograms[stage]; }
+	static const char* stageName(Stage stage);
+	static void reset();
+	static void dump();
+
+private:
+	static QAtomicInt m_enabled;
+	static LatencyHistogram m_histograms[StCount];
+};
+
+#endif // INCLUDE_LATENCY_H
@@ -3,46 +3,77 @@
 
 #include <stdlib.h>
 #include <QAtomicInt>
+#include "util/completion.h"
+#include "util/messagepool.h"
 #include "util/export.h"
 
 class MessageQueue;
-class QWaitCondition;
-class QMutex;
 
 class SDRANGELOVE_API Message {
 public:
 	Message();
 	virtual ~Message();
 
+	// messages created with new come from MessagePool - completing them does not touch the heap
+	static void* operator new(size_t size) { return MessagePool::allocate(size); }
+	static void operator delete(void* ptr, size_t size) { MessagePool::release(ptr, size); }
+
 	virtual const char* getIdentifier() const;
 	virtual bool matchIdentifier(const char* identifier) const;
 	static bool match(Message* message);
 
+	// compact type ids, assigned when a message class is used for the first time
+	virtual int getTypeId() const;
+	static int typeId() { return 0; }
+	bool isType(int typeId) const
+	{
+		int id = getTypeId();
+		return (id == typeId) || isDerivedType(id, typeId);
+	}
+	static int registerType(const char* name, int parentTypeId);
+	static int parentTypeId(int typeId);
+	static const char* typeName(int typeId);
+	static bool isDerivedType(int typeId, int baseTypeId);
+
 	void* getDestination() const { return m_destination; }
 
 	void submit(MessageQueue* queue, void* destination = NULL);
 	int execute(MessageQueue* queue, void* destination = NULL);
 
+	// waits at most timeoutMs for the result. On timeout false is returned and the message is
+	// deleted by whoever completes it later - so it has to be created with new and the caller
+	// must not touch it any more. On success the caller still owns it.
+	bool tryExecute(MessageQueue* queue, int timeoutMs, int* result = NULL, void* destination = NULL);
+
+	// asynchronous execute: once completed the message is posted to replyQueue, where its owner
+	// picks it up with its other messages, reads getResult() and disposes of it with completed()
+	void submitWithReply(MessageQueue* queue, MessageQueue* replyQueue, void* destination = NULL);
+
 	void completed(int result = 0);
+	int getResult() const { return m_completion.getResult(); }
 
 protected:
 	// addressing
 	static const char* m_identifier;
 	void* m_destination;
 
+	// link while the message sits in a MessageQueue
+	Message* m_next;
+	friend class MessageQueue;
+
 	// stuff for synchronous messages
 	bool m_synchronous;
-	QWaitCondition* m_waitCondition;
-	QMutex* m_mutex;
-	QAtomicInt m_complete;
-	int m_result;
+	Completion m_completion;
+	MessageQueue* m_replyQueue;
 };
 
 #define MESSAGE_CLASS_DECLARATION(Name) \
 	public: \
 		const char* getIdentifier() const; \
 		bool matchIdentifier(const char* identifier) const; \
-		static bool match(Message* message); \
+		int getTypeId() const; \
+		static int typeId(); \
+		static bool match(Message* message) { return message->isType(typeId()); } \
 		static Name* cast(Message* message) { return match(message) ? (Name*)message : NULL; } \
 	protected: \
 		static const char* m_identifier; \
@@ -54,6 +85,10 @@ protected:
 	bool Name::matchIdentifier(const char* identifier) const {\
 		return (m_identifier == identifier) ? true : BaseClass::matchIdentifier(identifier); \
 	} \
-	bool Name::match(Message* message) { return message->matchIdentifier(m_identifier); }
+	int Name::typeId() { \
+		static const int id = Message::registerType(#Name, BaseClass::typeId()); \
+		return id; \
+	} \
+	int Name::getTypeId() const { return typeId(); }
 
 #endif // INCLUDE_MESSAGE_H
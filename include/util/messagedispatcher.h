@@ -0,0 +1,39 @@
+#ifndef INCLUDE_MESSAGEDISPATCHER_H
+#define INCLUDE_MESSAGEDISPATCHER_H
+
+#include <vector>
+#include "util/message.h"
+
+// Table of message handlers indexed by message type id. Routing a message costs one lookup,
+// no matter how many types are registered. A message without a handler of its own is passed
+// to the handler of its base class, if there is one.
+template<class T> class MessageDispatcher {
+public:
+	typedef void (T::*Handler)(Message* message);
+
+	void add(int typeId, Handler handler)
+	{
+		if(typeId >= (int)m_handlers.size())
+			m_handlers.resize(typeId + 1, NULL);
+		m_handlers[typeId] = handler;
+	}
+
+	bool dispatch(T* receiver, Message* message) const
+	{
+		int typeId = message->getTypeId();
+		while(true) {
+			if((typeId < (int)m_handlers.size()) && (m_handlers[typeId] != NULL)) {
+				(receiver->*m_handlers[typeId])(message);
+				return true;
+			}
+			if(typeId == 0)
+				return false;
+			typeId = Message::parentTypeId(typeId);
+		}
+	}
+
+private:
+	std::vector<Handler> m_handlers;
+};
+
+#endif // INCLUDE_MESSAGEDISPATCHER_H
@@ -0,0 +1,49 @@
+#ifndef INCLUDE_MESSAGEPOOL_H
+#define INCLUDE_MESSAGEPOOL_H
+
+#include <stddef.h>
+#include "util/spinlock.h"
+#include "util/export.h"
+
+// Freelists for message objects, one per size class. Blocks are carved from slabs and never go
+// back to the heap, so once the pool has grown to the working set creating and completing a
+// message costs a spinlock and a pointer swap instead of a malloc/free pair.
+class SDRANGELOVE_API MessagePool {
+public:
+	static void* allocate(size_t size);
+	static void release(void* ptr, size_t size);
+
+	// blocks handed out / currently free, over all size classes
+	static int getAllocated();
+	static int getFree();
+	// contention on the size class locks, see Spinlock::setStatsEnabled()
+	static int getLockContended();
+	static int getLockSpins();
+	static void resetLockStats();
+	// puts the size class locks into the metrics registry, called once at startup
+	static void registerMetrics();
+
+private:
+	enum {
+		Granularity = 32,
+		NumSizeClasses = 8, // up to 256 bytes, anything larger goes to the heap
+		SlabBlocks = 32
+	};
+
+	struct Block {
+		Block* m_next;
+	};
+
+	struct SizeClass {
+		Spinlock m_lock;
+		Block* m_free;
+		int m_allocated;
+		int m_freeCount;
+	};
+
+	static SizeClass m_sizeClasses[NumSizeClasses];
+
+	static void grow(SizeClass* sizeClass, size_t blockSize);
+};
+
+#endif // INCLUDE_MESSAGEPOOL_H
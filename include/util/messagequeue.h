@@ -2,12 +2,17 @@
 #define INCLUDE_MESSAGEQUEUE_H
 
 #include <QObject>
-#include <QQueue>
-#include "spinlock.h"
+#include <QAtomicPointer>
+#include <QAtomicInt>
+#include "util/metrics.h"
 #include "util/export.h"
 
 class Message;
 
+// Intrusive multiple producer, single consumer queue. submit() may be called from any thread and
+// never blocks, accept() and countPending() belong to the thread handling the messages.
+// messageEnqueued() is emitted once per drain cycle: the consumer has to call accept() until it
+// returns NULL, then the next submit() wakes it up again.
 class SDRANGELOVE_API MessageQueue : public QObject {
 	Q_OBJECT
 
@@ -20,12 +25,19 @@ public:
 
 	int countPending();
 
+	void setMetricsName(const QString& name);
+
 signals:
 	void messageEnqueued();
 
 private:
-	Spinlock m_lock;
-	QQueue<Message*> m_queue;
+	QAtomicPointer<Message> m_pushed; // newest first, linked through Message::m_next
+	QAtomicInt m_wakeupPending;
+	Message* m_batch; // owned by the consumer, oldest first
+	int m_batchSize;
+	Metric m_depthMetric;
+
+	void takeBatch();
 };
 
 #endif // INCLUDE_MESSAGEQUEUE_H
@@ -0,0 +1,74 @@
+#ifndef INCLUDE_METRICS_H
+#define INCLUDE_METRICS_H
+
+#include <QAtomicInt>
+#include <QString>
+#include <QList>
+#include "util/export.h"
+
+// One counter or gauge of the engine wide metrics registry. Metrics register themselves while
+// they exist. The owner updates a metric with a single atomic operation and never takes a lock:
+// counters only collect what happened since the last Metrics::collect(), which folds it into a
+// 64 bit total. A gauge may also mirror an atomic its owner keeps anyway (setSource()), then the
+// hot path does not touch the metric at all.
+class SDRANGELOVE_API Metric {
+public:
+	enum Type {
+		MtCounter,
+		MtGauge
+	};
+
+	// name and help must be string literals, all metrics of one name share the help text
+	Metric(Type type, const char* name, const char* help);
+	~Metric();
+
+	// label set in Prometheus syntax without the braces, e.g. fifo="source"
+	void setLabels(const QString& labels);
+	void setSource(const QAtomicInt* source) { m_source = source; }
+
+	void add(int n = 1) { m_pending.fetchAndAddRelaxed(n); }
+	void set(int value) { m_pending.storeRelease(value); }
+
+private:
+	friend class Metrics;
+
+	Type m_type;
+	const char* m_name;
+	const char* m_help;
+	QString m_labels;
+	const QAtomicInt* m_source;
+
+	QAtomicInt m_pending;
+	qint64 m_total; // counters, owned by Metrics::collect()
+};
+
+class SDRANGELOVE_API Metrics {
+public:
+	struct Value {
+		QString m_name;
+		QString m_help;
+		QString m_labels;
+		Metric::Type m_type;
+		double m_value;
+	};
+	typedef QList<Value> Values;
+
+	// snapshot of all metrics, sorted by name - may be called from any thread
+	static Values collect();
+	// the snapshot in the Prometheus text exposition format
+	static QString exposition();
+
+	// unique label value for owners without a name of their own, e.g. "fifo-3"
+	static QString instanceName(const char* prefix);
+
+	// makes the CPU time of the calling thread visible as sdr_thread_cpu_seconds_total
+	static void registerThread(const QString& name);
+
+private:
+	friend class Metric;
+
+	static void add(Metric* metric);
+	static void remove(Metric* metric);
+};
+
+#endif // INCLUDE_METRICS_H
@@ -0,0 +1,35 @@
+#ifndef INCLUDE_METRICSEXPORTER_H
+#define INCLUDE_METRICSEXPORTER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QFile>
+#include "util/export.h"
+
+class QTcpServer;
+
+// Makes the metrics registry available outside of the GUI: as a plaintext endpoint in the
+// Prometheus format which only accepts connections from the local host (any request path is
+// answered with all metrics), and as a log file the snapshot is appended to periodically.
+class SDRANGELOVE_API MetricsExporter : public QObject {
+	Q_OBJECT
+
+public:
+	MetricsExporter(QObject* parent = NULL);
+	~MetricsExporter();
+
+	bool listen(quint16 port);
+	bool startLog(const QString& fileName, int intervalS);
+
+private:
+	QTcpServer* m_server;
+	QFile m_logFile;
+	QTimer m_logTimer;
+
+private slots:
+	void newConnection();
+	void readRequest();
+	void writeLog();
+};
+
+#endif // INCLUDE_METRICSEXPORTER_H
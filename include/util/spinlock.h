@@ -2,21 +2,74 @@
 #define INCLUDE_SPINLOCK_H
 
 #include <QAtomicInt>
+#include "util/metrics.h"
+#include "util/export.h"
 
-class Spinlock {
+// Lock for very short critical sections. An uncontended lock() is a single CAS. Under contention
+// the waiter spins with pause instructions and exponential backoff, then yields its time slice and
+// finally sleeps, so a holder that got preempted does not keep the other threads burning cores.
+class SDRANGELOVE_API Spinlock {
 public:
+	Spinlock() :
+		m_atomic(0),
+		m_contended(0),
+		m_spins(0)
+	{ }
+
 	void lock()
 	{
-		while(!m_atomic.testAndSetAcquire(0, 1)) ;
+		if(!m_atomic.testAndSetAcquire(0, 1))
+			lockContended();
+	}
+
+	bool tryLock()
+	{
+		return m_atomic.testAndSetAcquire(0, 1);
 	}
 
 	void unlock()
 	{
-		while(!m_atomic.testAndSetRelease(1, 0)) ;
+		m_atomic.storeRelease(0);
 	}
 
+	// contention statistics, only counted while enabled
+	static bool isStatsEnabled() { return m_statsEnabled.loadAcquire() != 0; }
+	static void setStatsEnabled(bool enabled);
+
+	int getContended() const { return m_contended.loadAcquire(); }
+	int getSpins() const { return m_spins.loadAcquire(); }
+	void resetStats();
+
 protected:
+	enum {
+		MaxBackoff = 64,  // pause instructions per round at most
+		SpinRounds = 16,  // rounds of pausing before yielding
+		YieldRounds = 16, // rounds of yielding before sleeping
+		SleepUs = 50
+	};
+
 	QAtomicInt m_atomic;
+	QAtomicInt m_contended;
+	QAtomicInt m_spins;
+
+	static QAtomicInt m_statsEnabled;
+
+	friend class SpinlockMetrics;
+
+	void lockContended();
+};
+
+// Shows the contention statistics of one lock in the metrics registry, labelled lock="<name>".
+// Mirrors the counters of the lock, so the lock itself does not get any slower.
+class SDRANGELOVE_API SpinlockMetrics {
+public:
+	SpinlockMetrics(const Spinlock* spinlock);
+
+	void setName(const QString& name);
+
+private:
+	Metric m_contendedMetric;
+	Metric m_spinsMetric;
 };
 
 class SpinlockHolder {
@@ -0,0 +1,63 @@
+#ifndef INCLUDE_THREADPOLICY_H
+#define INCLUDE_THREADPOLICY_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include "util/export.h"
+
+// CPU placement and scheduling policy per class of thread. The configuration comes from the
+// preferences, the command line overrides it. Every thread applies it to itself with apply()
+// when it starts, so a change takes effect the next time a thread of that class is started.
+class SDRANGELOVE_API ThreadPolicy {
+public:
+	enum ThreadClass {
+		TcEngine, // DSPEngine
+		TcSource, // sample source threads (RTLSDRThread, OsmoSDRThread, ...)
+		TcSink,   // ThreadedSampleSink and SinkWorkerPool workers
+		// DSPPipeline stages - a class of their own so that pinning the engine to one CPU does
+		// not put all stages on that CPU as well; unpinned unless configured
+		TcPipeline,
+		TcCount
+	};
+
+	enum Scheduling {
+		SchedOther, // whatever the OS does by default
+		SchedFifo,
+		SchedRR
+	};
+
+	struct Config {
+		QString m_cpus; // "0-3,6", empty means all
+		Scheduling m_scheduling;
+		int m_priority; // only used for SchedFifo / SchedRR
+
+		Config() :
+			m_cpus(),
+			m_scheduling(SchedOther),
+			m_priority(0)
+		{ }
+	};
+
+	static void setConfig(ThreadClass threadClass, const Config& config);
+	static Config getConfig(ThreadClass threadClass);
+
+	// "<class>:<cpus>[:<other|fifo|rr>[:<priority>]]", e.g. "engine:2-3:fifo:50"
+	static bool setOverride(const QString& spec);
+	static const char* usage();
+
+	// names the calling thread and applies the configuration of its class; failures are logged
+	// and the thread keeps running with whatever it got
+	static void apply(ThreadClass threadClass, const char* name);
+
+	static const char* className(ThreadClass threadClass);
+	static const char* schedulingName(Scheduling scheduling);
+	static bool parseCpuSet(const QString& cpus, QList<int>* result);
+
+private:
+	static QMutex m_mutex;
+	static Config m_configs[TcCount];
+	static bool m_overridden[TcCount];
+};
+
+#endif // INCLUDE_THREADPOLICY_H
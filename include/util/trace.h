@@ -0,0 +1,51 @@
+#ifndef INCLUDE_TRACE_H
+#define INCLUDE_TRACE_H
+
+#include <QString>
+#include "util/export.h"
+
+// Timeline of the hot paths in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Every thread records into a ring of its own which only it writes to, so recording takes no
+// lock; the oldest events are overwritten. Names must be string literals, only the pointer is
+// kept. Only built with -DENABLE_TRACE=ON (defines USE_TRACE), otherwise the macros below expand
+// to nothing and the functions do nothing.
+class SDRANGELOVE_API Trace {
+public:
+	enum Phase {
+		PhBegin = 'B',
+		PhEnd = 'E',
+		PhInstant = 'i'
+	};
+
+	static bool isCompiledIn();
+
+	static void record(const char* name, Phase phase);
+	// names the ring of the calling thread in the dump
+	static void setThreadName(const QString& name);
+
+	// writes the events of the last seconds of all threads
+	static bool dump(const QString& fileName, int seconds);
+};
+
+class TraceScope {
+public:
+	TraceScope(const char* name) : m_name(name) { Trace::record(m_name, Trace::PhBegin); }
+	~TraceScope() { Trace::record(m_name, Trace::PhEnd); }
+
+private:
+	const char* m_name;
+};
+
+#ifdef USE_TRACE
+#define TRACE_SCOPE(name) TraceScope traceScope(name)
+#define TRACE_BEGIN(name) Trace::record(name, Trace::PhBegin)
+#define TRACE_END(name) Trace::record(name, Trace::PhEnd)
+#define TRACE_INSTANT(name) Trace::record(name, Trace::PhInstant)
+#else
+#define TRACE_SCOPE(name) do { } while(0)
+#define TRACE_BEGIN(name) do { } while(0)
+#define TRACE_END(name) do { } while(0)
+#define TRACE_INSTANT(name) do { } while(0)
+#endif
+
+#endif // INCLUDE_TRACE_H
@@ -0,0 +1,67 @@
+#ifndef INCLUDE_TRIPLEBUFFER_H
+#define INCLUDE_TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+// Single producer, single consumer "latest value" mailbox. The producer fills
+// writeBuffer() and publishes it, the consumer picks up the most recently
+// published buffer. Neither side ever blocks - frames the consumer was too slow
+// for are overwritten and counted as skipped.
+template<typename T> class TripleBuffer {
+public:
+	TripleBuffer() :
+		m_back(0),
+		m_middle(1),
+		m_front(2),
+		m_produced(0),
+		m_consumed(0),
+		m_skipped(0)
+	{ }
+
+	// producer side
+	T& writeBuffer() { return m_buffers[m_back]; }
+
+	void publish()
+	{
+		int old = m_middle.fetchAndStoreOrdered(m_back | FreshBit);
+		m_back = old & IndexMask;
+		m_produced.fetchAndAddRelaxed(1);
+		if(old & FreshBit)
+			m_skipped.fetchAndAddRelaxed(1);
+	}
+
+	// consumer side - returns true if a new buffer has been published since the last call
+	bool update()
+	{
+		if(!pending())
+			return false;
+		int old = m_middle.fetchAndStoreOrdered(m_front);
+		m_front = old & IndexMask;
+		m_consumed.fetchAndAddRelaxed(1);
+		return true;
+	}
+
+	bool pending() const { return (m_middle.loadAcquire() & FreshBit) != 0; }
+	const T& readBuffer() const { return m_buffers[m_front]; }
+
+	int getProduced() const { return m_produced.loadAcquire(); }
+	int getConsumed() const { return m_consumed.loadAcquire(); }
+	int getSkipped() const { return m_skipped.loadAcquire(); }
+
+private:
+	enum {
+		IndexMask = 0x03,
+		FreshBit = 0x04
+	};
+
+	T m_buffers[3];
+	int m_back; // owned by the producer
+	QAtomicInt m_middle; // index of the buffer in transit plus fresh flag
+	int m_front; // owned by the consumer
+
+	QAtomicInt m_produced;
+	QAtomicInt m_consumed;
+	QAtomicInt m_skipped;
+};
+
+#endif // INCLUDE_TRIPLEBUFFER_H
@@ -20,7 +20,18 @@
 #include <QProxyStyle>
 #include <QStyleFactory>
 #include <QFontDatabase>
+#include <stdio.h>
 #include "mainwindow.h"
+#include "util/threadpolicy.h"
+#include "util/metrics.h"
+#include "util/metricsexporter.h"
+#include "util/messagepool.h"
+#include "util/trace.h"
+
+static const char* metricsUsage =
+	"  --metrics-port <port>      serve the metrics on http://127.0.0.1:<port>/metrics\n"
+	"  --metrics-log <file>       append the metrics to <file> periodically\n"
+	"  --metrics-interval <s>     seconds between two log entries (default 10)\n";
 
 static int runQtApplication(int argc, char* argv[])
 {
@@ -32,6 +43,39 @@ static int runQtApplication(int argc, char* argv[])
 	QCoreApplication::setOrganizationName("osmocom");
 	QCoreApplication::setApplicationName("SDRangelove");
 
+	Metrics::registerThread("sdr-gui");
+	MessagePool::registerMetrics();
+	Trace::setThreadName("sdr-gui");
+	MetricsExporter metricsExporter;
+	int metricsPort = 0;
+	QString metricsLog;
+	int metricsInterval = 10;
+
+	QStringList args = a.arguments();
+	for(int i = 1; i < args.size(); i++) {
+		if((args[i] == "--thread-policy") && (i + 1 < args.size())) {
+			if(!ThreadPolicy::setOverride(args[++i]))
+				fprintf(stderr, "invalid thread policy \"%s\"\n%s", qPrintable(args[i]), ThreadPolicy::usage());
+		} else if((args[i] == "--metrics-port") && (i + 1 < args.size())) {
+			metricsPort = args[++i].toInt();
+		} else if((args[i] == "--metrics-log") && (i + 1 < args.size())) {
+			metricsLog = args[++i];
+		} else if((args[i] == "--metrics-interval") && (i + 1 < args.size())) {
+			metricsInterval = args[++i].toInt();
+		} else if((args[i] == "--help") || (args[i] == "-h")) {
+			fprintf(stderr, "usage: %s [options]\n%s%s", qPrintable(args[0]), ThreadPolicy::usage(), metricsUsage);
+			return 0;
+		}
+	}
+
+	if(metricsPort > 0)
+		metricsExporter.listen(metricsPort);
+	if(!metricsLog.isEmpty())
+		metricsExporter.startLog(metricsLog, metricsInterval);
+	// the lock contention metrics stay at 0 otherwise
+	if((metricsPort > 0) || !metricsLog.isEmpty())
+		Spinlock::setStatsEnabled(true);
+
 #if 1
 	qApp->setStyle(QStyleFactory::create("fusion"));
 
@@ -21,13 +21,14 @@
 #include "nfmdemod.h"
 #include "audio/audiooutput.h"
 #include "dsp/dspcommands.h"
-#include "dsp/pidcontroller.h"
+#include "util/trace.h"
 
 MESSAGE_CLASS_DEFINITION(NFMDemod::MsgConfigureNFMDemod, Message)
 
 NFMDemod::NFMDemod(AudioFifo* audioFifo, SampleSink* sampleSink) :
-	m_sampleSink(sampleSink),
-	m_audioFifo(audioFifo)
+	m_audioFifo(audioFifo),
+	m_audioResampler(audioFifo),
+	m_sampleSink(sampleSink)
 {
 	m_config.m_inputSampleRate = 500000;
 	m_config.m_inputFrequencyOffset = 0;
@@ -39,9 +40,6 @@ NFMDemod::NFMDemod(AudioFifo* audioFifo, SampleSink* sampleSink) :
 
 	apply();
 
-	m_audioBuffer.resize(16384);
-	m_audioBufferFill = 0;
-
 	m_movingAverage.resize(16, 0);
 }
 
@@ -87,6 +85,7 @@ Real angleDist(Real a, Real b)
 
 void NFMDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
+	TRACE_SCOPE("NFMDemod::feed");
 	Complex ci;
 	bool consumed;
 
@@ -98,28 +97,8 @@ void NFMDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iter
 		apply();
 	}
 
-	if(firstOfBurst) {
-		if(m_audioFifo->isStopped()) {
-			if(m_audioFifo->fill() >= m_audioFifo->size() / 8.0) {
-				m_audioFifo->setStopped(false);
-				m_interpolatorRegulation = 0.9999;
-			}
-		} else {
-			Real err = (Real)m_audioFifo->fill() / ((Real)m_audioFifo->size() / 9.0);
-			if(err < 0.999)
-				err = 0.999;
-			else if(err > 1.001)
-				err = 1.001;
-
-			m_interpolatorRegulation = (m_interpolatorRegulation * 400.0 + err * 1.0) / 401.0;
-
-			if(m_interpolatorRegulation < 0.99)
-				m_interpolatorRegulation = 0.99;
-			else if(m_interpolatorRegulation > 1.01)
-				m_interpolatorRegulation = 1.01;
-		}
-		m_interpolatorDistance = m_interpolatorRegulation * (Real)m_running.m_inputSampleRate / (Real)m_running.m_audioSampleRate;
-	}
+	if(m_running.m_audioSampleRate == 0)
+		return;
 
 	for(SampleVector::const_iterator it = begin; it != end; ++it) {
 		Complex c(it->real() / 32768.0, it->imag() / 32768.0);
@@ -134,7 +113,7 @@ void NFMDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iter
 				if(m_movingAverage.average() >= m_squelchLevel)
 					m_squelchState = m_running.m_audioSampleRate/ 20;
 
-				qint16 sample;
+				Real sample;
 
 				m_squelchState = 999;
 				if(m_squelchState > 0) {
@@ -166,33 +145,22 @@ void NFMDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iter
 					else if(demod > 1)
 						demod = 1;
 
-					demod *= m_running.m_volume;
-					sample = demod * 32700;
+					sample = demod * m_running.m_volume;
 
 				} else {
 					sample = 0;
 					qDebug("!!!");
 				}
 
-				m_audioBuffer[m_audioBufferFill].l = sample;
-				m_audioBuffer[m_audioBufferFill].r = sample;
-				++m_audioBufferFill;
-				if(m_audioBufferFill >= m_audioBuffer.size()) {
-					uint res = m_audioFifo->write((const quint8*)&m_audioBuffer[0], m_audioBufferFill, 1);
-					if(res != m_audioBufferFill)
-						qDebug("lost %u audio samples", m_audioBufferFill - res);
-					m_audioBufferFill = 0;
-				}
+				m_audioBuffer.push_back(sample);
 
 				m_interpolatorDistanceRemain += m_interpolatorDistance;
 			}
 		}
 	}
-	if(m_audioBufferFill > 0) {
-		uint res = m_audioFifo->write((const quint8*)&m_audioBuffer[0], m_audioBufferFill, 1);
-		if(res != m_audioBufferFill)
-			qDebug("lost %u samples", m_audioBufferFill - res);
-		m_audioBufferFill = 0;
+	if(!m_audioBuffer.empty()) {
+		m_audioResampler.feed(&m_audioBuffer[0], m_audioBuffer.size());
+		m_audioBuffer.clear();
 	}
 
 	if(m_sampleSink != NULL)
@@ -203,10 +171,7 @@ void NFMDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iter
 void NFMDemod::start()
 {
 	m_squelchState = 0;
-	m_audioFifo->clear();
-	m_audioFifo->setStopped(true);
-	m_interpolatorRegulation = 0.9999;
-	m_interpolatorDistance = 1.0;
+	m_audioResampler.reset();
 	m_interpolatorDistanceRemain = 0.0;
 	m_lastSample = 0;
 }
@@ -232,6 +197,7 @@ bool NFMDemod::handleMessage(Message* cmd)
 		m_config.m_volume = cfg->getVolume();
 		m_config.m_squelch = cfg->getSquelch();
 		apply();
+		cmd->completed();
 		return true;
 	} else {
 		if(m_sampleSink != NULL)
@@ -252,7 +218,14 @@ void NFMDemod::apply()
 		(m_config.m_rfBandwidth != m_running.m_rfBandwidth)) {
 		m_interpolator.create(16, m_config.m_inputSampleRate, m_config.m_rfBandwidth / 2.2);
 		m_interpolatorDistanceRemain = 0;
-		m_interpolatorDistance = 1.0;
+	}
+
+	if((m_config.m_inputSampleRate != m_running.m_inputSampleRate) ||
+		(m_config.m_audioSampleRate != m_running.m_audioSampleRate)) {
+		// decimate to the nominal audio rate, the resampler tracks the sound card clock
+		if(m_config.m_audioSampleRate > 0)
+			m_interpolatorDistance = (Real)m_config.m_inputSampleRate / (Real)m_config.m_audioSampleRate;
+		m_audioResampler.configure(m_config.m_audioSampleRate, m_config.m_audioSampleRate);
 	}
 
 	if((m_config.m_afBandwidth != m_running.m_afBandwidth) ||
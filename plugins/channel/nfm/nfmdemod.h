@@ -24,6 +24,7 @@
 #include "dsp/interpolator.h"
 #include "dsp/lowpass.h"
 #include "dsp/movingaverage.h"
+#include "dsp/audioresampler.h"
 #include "audio/audiofifo.h"
 #include "util/message.h"
 
@@ -71,17 +72,6 @@ private:
 		{ }
 	};
 
-	struct AudioSample {
-		qint16 l;
-		qint16 r;
-	};
-	typedef std::vector<AudioSample> AudioVector;
-
-	enum RateState {
-		RSInitialFill,
-		RSRunning
-	};
-
 	struct Config {
 		int m_inputSampleRate;
 		qint64 m_inputFrequencyOffset;
@@ -106,7 +96,6 @@ private:
 	Config m_running;
 
 	NCO m_nco;
-	Real m_interpolatorRegulation;
 	Interpolator m_interpolator;
 	Real m_interpolatorDistance;
 	Real m_interpolatorDistanceRemain;
@@ -119,9 +108,9 @@ private:
 	Complex m_lastSample;
 	MovingAverage m_movingAverage;
 
-	AudioVector m_audioBuffer;
-	uint m_audioBufferFill;
+	std::vector<Real> m_audioBuffer;
 	AudioFifo* m_audioFifo;
+	AudioResampler m_audioResampler;
 
 	SampleSink* m_sampleSink;
 	SampleVector m_sampleBuffer;
@@ -4,7 +4,7 @@
 #include "ui_nfmdemodgui.h"
 #include "nfmdemodgui.h"
 #include "ui_nfmdemodgui.h"
-#include "dsp/threadedsamplesink.h"
+#include "dsp/decoupledsamplesink.h"
 #include "dsp/channelizer.h"
 #include "nfmdemod.h"
 #include "dsp/spectrumvis.h"
@@ -31,6 +31,8 @@ void NFMDemodGUI::destroy()
 void NFMDemodGUI::setName(const QString& name)
 {
 	setObjectName(name);
+	// the metrics and sink profiles carry the instance name as well
+	m_channelSink->setMetricsName(name);
 }
 
 void NFMDemodGUI::resetToDefaults()
@@ -39,6 +41,8 @@ void NFMDemodGUI::resetToDefaults()
 	ui->afBW->setValue(3);
 	ui->volume->setValue(20);
 	ui->squelch->setValue(-40);
+	ui->mute->setChecked(false);
+	ui->outputGain->setValue(10);
 	ui->spectrumGUI->resetToDefaults();
 	applySettings();
 }
@@ -53,6 +57,8 @@ QByteArray NFMDemodGUI::serialize() const
 	s.writeS32(5, ui->squelch->value());
 	s.writeBlob(6, ui->spectrumGUI->serialize());
 	s.writeU32(7, m_channelMarker->getColor().rgb());
+	s.writeBool(8, ui->mute->isChecked());
+	s.writeS32(9, ui->outputGain->value());
 	return s.final();
 }
 
@@ -69,6 +75,7 @@ bool NFMDemodGUI::deserialize(const QByteArray& data)
 		QByteArray bytetmp;
 		quint32 u32tmp;
 		qint32 tmp;
+		bool booltmp;
 		d.readS32(1, &tmp, 0);
 		m_channelMarker->setCenterFrequency(tmp);
 		d.readS32(2, &tmp, 4);
@@ -83,6 +90,10 @@ bool NFMDemodGUI::deserialize(const QByteArray& data)
 		ui->spectrumGUI->deserialize(bytetmp);
 		if(d.readU32(7, &u32tmp))
 			m_channelMarker->setColor(u32tmp);
+		d.readBool(8, &booltmp, false);
+		ui->mute->setChecked(booltmp);
+		d.readS32(9, &tmp, 10);
+		ui->outputGain->setValue(tmp);
 		applySettings();
 		return true;
 	} else {
@@ -120,6 +131,17 @@ void NFMDemodGUI::on_volume_valueChanged(int value)
 	applySettings();
 }
 
+void NFMDemodGUI::on_mute_toggled(bool checked)
+{
+	m_audioFifo->setMuted(checked);
+}
+
+void NFMDemodGUI::on_outputGain_valueChanged(int value)
+{
+	ui->outputGainText->setText(QString("%1").arg(value / 10.0, 0, 'f', 1));
+	m_audioFifo->setGain(value / 10.0);
+}
+
 void NFMDemodGUI::on_squelch_valueChanged(int value)
 {
 	ui->squelchText->setText(QString("%1 dB").arg(value));
@@ -131,7 +153,7 @@ void NFMDemodGUI::onWidgetRolled(QWidget* widget, bool rollDown)
 {
 	/*
 	if((widget == ui->spectrumContainer) && (m_nfmDemod != NULL))
-		m_nfmDemod->setSpectrum(m_threadedSampleSink->getMessageQueue(), rollDown);
+		m_nfmDemod->setSpectrum(m_channelSink->getMessageQueue(), rollDown);
 	*/
 }
 
@@ -159,15 +181,16 @@ NFMDemodGUI::NFMDemodGUI(PluginAPI* pluginAPI, QWidget* parent) :
 	m_spectrumVis = new SpectrumVis(ui->glSpectrum);
 	m_nfmDemod = new NFMDemod(m_audioFifo, m_spectrumVis);
 	m_channelizer = new Channelizer(m_nfmDemod);
-	m_threadedSampleSink = new ThreadedSampleSink(m_channelizer);
+	m_channelSink = m_pluginAPI->createChannelSink(m_channelizer);
+	m_channelSink->setMetricsName(Metrics::instanceName("nfm"));
 	m_pluginAPI->addAudioSource(m_audioFifo);
-	m_pluginAPI->addSampleSink(m_threadedSampleSink);
+	m_pluginAPI->addSampleSink(m_channelSink);
 
 	ui->glSpectrum->setCenterFrequency(0);
 	ui->glSpectrum->setSampleRate(48000);
 	ui->glSpectrum->setDisplayWaterfall(true);
 	ui->glSpectrum->setDisplayMaxHold(true);
-	m_spectrumVis->configure(m_threadedSampleSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
+	m_spectrumVis->configure(m_channelSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
 
 	m_channelMarker = new ChannelMarker(this);
 	m_channelMarker->setColor(Qt::red);
@@ -177,7 +200,7 @@ NFMDemodGUI::NFMDemodGUI(PluginAPI* pluginAPI, QWidget* parent) :
 	connect(m_channelMarker, SIGNAL(changed()), this, SLOT(viewChanged()));
 	m_pluginAPI->addChannelMarker(m_channelMarker);
 
-	ui->spectrumGUI->setBuddies(m_threadedSampleSink->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
+	ui->spectrumGUI->setBuddies(m_channelSink->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
 
 	applySettings();
 }
@@ -186,8 +209,8 @@ NFMDemodGUI::~NFMDemodGUI()
 {
 	m_pluginAPI->removeChannelInstance(this);
 	m_pluginAPI->removeAudioSource(m_audioFifo);
-	m_pluginAPI->removeSampleSink(m_threadedSampleSink);
-	delete m_threadedSampleSink;
+	m_pluginAPI->removeSampleSink(m_channelSink);
+	delete m_channelSink;
 	delete m_channelizer;
 	delete m_nfmDemod;
 	delete m_spectrumVis;
@@ -199,10 +222,10 @@ NFMDemodGUI::~NFMDemodGUI()
 void NFMDemodGUI::applySettings()
 {
 	setTitleColor(m_channelMarker->getColor());
-	m_channelizer->configure(m_threadedSampleSink->getMessageQueue(),
+	m_channelizer->configure(m_channelSink->getMessageQueue(),
 		48000,
 		m_channelMarker->getCenterFrequency());
-	m_nfmDemod->configure(m_threadedSampleSink->getMessageQueue(),
+	m_nfmDemod->configure(m_channelSink->getMessageQueue(),
 		m_rfBW[ui->rfBW->value()],
 		ui->afBW->value() * 1000.0,
 		ui->volume->value() / 10.0,
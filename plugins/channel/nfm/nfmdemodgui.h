@@ -8,7 +8,7 @@ class PluginAPI;
 class ChannelMarker;
 
 class AudioFifo;
-class ThreadedSampleSink;
+class DecoupledSampleSink;
 class Channelizer;
 class NFMDemod;
 class SpectrumVis;
@@ -37,6 +37,8 @@ private slots:
 	void on_rfBW_valueChanged(int value);
 	void on_afBW_valueChanged(int value);
 	void on_volume_valueChanged(int value);
+	void on_mute_toggled(bool checked);
+	void on_outputGain_valueChanged(int value);
 	void on_squelch_valueChanged(int value);
 	void onWidgetRolled(QWidget* widget, bool rollDown);
 	void onMenuDoubleClicked();
@@ -48,7 +50,7 @@ private:
 	bool m_basicSettingsShown;
 
 	AudioFifo* m_audioFifo;
-	ThreadedSampleSink* m_threadedSampleSink;
+	DecoupledSampleSink* m_channelSink;
 	Channelizer* m_channelizer;
 	NFMDemod* m_nfmDemod;
 	SpectrumVis* m_spectrumVis;
@@ -4,6 +4,7 @@
 #include "tcpsrc.h"
 #include "tcpsrcgui.h"
 #include "dsp/dspcommands.h"
+#include "util/trace.h"
 
 MESSAGE_CLASS_DEFINITION(TCPSrc::MsgTCPSrcConfigure, Message)
 MESSAGE_CLASS_DEFINITION(TCPSrc::MsgTCPSrcConnection, Message)
@@ -45,6 +46,7 @@ void TCPSrc::setSpectrum(MessageQueue* messageQueue, bool enabled)
 
 void TCPSrc::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
+	TRACE_SCOPE("TCPSrc::feed");
 	Complex ci;
 	bool consumed;
 
@@ -98,7 +100,7 @@ void TCPSrc::stop()
 bool TCPSrc::handleMessage(Message* cmd)
 {
 	if(DSPSignalNotification::match(cmd)) {
-		DSPSignalNotification* signal = (DSPSignalNotification*)cmd;
+		DSPSignalNotification* signal = DSPSignalNotification::cast(cmd);
 		qDebug("%d samples/sec, %lld Hz offset", signal->getSampleRate(), signal->getFrequencyOffset());
 		m_inputSampleRate = signal->getSampleRate();
 		m_nco.setFreq(-signal->getFrequencyOffset(), m_inputSampleRate);
@@ -106,8 +108,8 @@ bool TCPSrc::handleMessage(Message* cmd)
 		m_sampleDistanceRemain = m_inputSampleRate / m_outputSampleRate;
 		cmd->completed();
 		return true;
-	} else if(DSPSignalNotification::match(cmd)) {
-		MsgTCPSrcConfigure* cfg = (MsgTCPSrcConfigure*)cmd;
+	} else if(MsgTCPSrcConfigure::match(cmd)) {
+		MsgTCPSrcConfigure* cfg = MsgTCPSrcConfigure::cast(cmd);
 		m_sampleFormat = cfg->getSampleFormat();
 		m_outputSampleRate = cfg->getOutputSampleRate();
 		m_rfBandwidth = cfg->getRFBandwidth();
@@ -122,7 +124,7 @@ bool TCPSrc::handleMessage(Message* cmd)
 		cmd->completed();
 		return true;
 	} else if(MsgTCPSrcSpectrum::match(cmd)) {
-		MsgTCPSrcSpectrum* spc = (MsgTCPSrcSpectrum*)cmd;
+		MsgTCPSrcSpectrum* spc = MsgTCPSrcSpectrum::cast(cmd);
 		m_spectrumEnabled = spc->getEnabled();
 		cmd->completed();
 		return true;
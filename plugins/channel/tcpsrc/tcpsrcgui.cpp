@@ -3,7 +3,7 @@
 #include "tcpsrc.h"
 #include "dsp/channelizer.h"
 #include "dsp/spectrumvis.h"
-#include "dsp/threadedsamplesink.h"
+#include "dsp/decoupledsamplesink.h"
 #include "util/simpleserializer.h"
 #include "gui/basicchannelsettingswidget.h"
 #include "ui_tcpsrcgui.h"
@@ -22,6 +22,8 @@ void TCPSrcGUI::destroy()
 void TCPSrcGUI::setName(const QString& name)
 {
 	setObjectName(name);
+	// the metrics and sink profiles carry the instance name as well
+	m_channelSink->setMetricsName(name);
 }
 
 void TCPSrcGUI::resetToDefaults()
@@ -131,14 +133,15 @@ TCPSrcGUI::TCPSrcGUI(PluginAPI* pluginAPI, QWidget* parent) :
 	m_spectrumVis = new SpectrumVis(ui->glSpectrum);
 	m_tcpSrc = new TCPSrc(m_pluginAPI->getMainWindowMessageQueue(), this, m_spectrumVis);
 	m_channelizer = new Channelizer(m_tcpSrc);
-	m_threadedSampleSink = new ThreadedSampleSink(m_channelizer);
-	m_pluginAPI->addSampleSink(m_threadedSampleSink);
+	m_channelSink = m_pluginAPI->createChannelSink(m_channelizer);
+	m_channelSink->setMetricsName(Metrics::instanceName("tcpsrc"));
+	m_pluginAPI->addSampleSink(m_channelSink);
 
 	ui->glSpectrum->setCenterFrequency(0);
 	ui->glSpectrum->setSampleRate(ui->sampleRate->text().toInt());
 	ui->glSpectrum->setDisplayWaterfall(true);
 	ui->glSpectrum->setDisplayMaxHold(true);
-	m_spectrumVis->configure(m_threadedSampleSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
+	m_spectrumVis->configure(m_channelSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
 
 	m_channelMarker = new ChannelMarker(this);
 	m_channelMarker->setBandwidth(25000);
@@ -147,7 +150,7 @@ TCPSrcGUI::TCPSrcGUI(PluginAPI* pluginAPI, QWidget* parent) :
 	connect(m_channelMarker, SIGNAL(changed()), this, SLOT(channelMarkerChanged()));
 	m_pluginAPI->addChannelMarker(m_channelMarker);
 
-	ui->spectrumGUI->setBuddies(m_threadedSampleSink->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
+	ui->spectrumGUI->setBuddies(m_channelSink->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
 
 	applySettings();
 }
@@ -155,8 +158,8 @@ TCPSrcGUI::TCPSrcGUI(PluginAPI* pluginAPI, QWidget* parent) :
 TCPSrcGUI::~TCPSrcGUI()
 {
 	m_pluginAPI->removeChannelInstance(this);
-	m_pluginAPI->removeSampleSink(m_threadedSampleSink);
-	delete m_threadedSampleSink;
+	m_pluginAPI->removeSampleSink(m_channelSink);
+	delete m_channelSink;
 	delete m_channelizer;
 	delete m_tcpSrc;
 	delete m_spectrumVis;
@@ -187,7 +190,7 @@ void TCPSrcGUI::applySettings()
 	connect(m_channelMarker, SIGNAL(changed()), this, SLOT(channelMarkerChanged()));
 	ui->glSpectrum->setSampleRate(outputSampleRate);
 
-	m_channelizer->configure(m_threadedSampleSink->getMessageQueue(),
+	m_channelizer->configure(m_channelSink->getMessageQueue(),
 		outputSampleRate,
 		m_channelMarker->getCenterFrequency());
 
@@ -209,7 +212,7 @@ void TCPSrcGUI::applySettings()
 	m_rfBandwidth = rfBandwidth;
 	m_tcpPort = tcpPort;
 
-	m_tcpSrc->configure(m_threadedSampleSink->getMessageQueue(),
+	m_tcpSrc->configure(m_channelSink->getMessageQueue(),
 		sampleFormat,
 		outputSampleRate,
 		rfBandwidth,
@@ -246,7 +249,7 @@ void TCPSrcGUI::on_applyBtn_clicked()
 void TCPSrcGUI::onWidgetRolled(QWidget* widget, bool rollDown)
 {
 	if((widget == ui->spectrumBox) && (m_tcpSrc != NULL))
-		m_tcpSrc->setSpectrum(m_threadedSampleSink->getMessageQueue(), rollDown);
+		m_tcpSrc->setSpectrum(m_channelSink->getMessageQueue(), rollDown);
 }
 
 void TCPSrcGUI::onMenuDoubleClicked()
@@ -8,7 +8,7 @@
 
 class PluginAPI;
 class ChannelMarker;
-class ThreadedSampleSink;
+class DecoupledSampleSink;
 class Channelizer;
 class TCPSrc;
 class SpectrumVis;
@@ -55,7 +55,7 @@ private:
 	bool m_basicSettingsShown;
 
 	// RF path
-	ThreadedSampleSink* m_threadedSampleSink;
+	DecoupledSampleSink* m_channelSink;
 	Channelizer* m_channelizer;
 	TCPSrc* m_tcpSrc;
 	SpectrumVis* m_spectrumVis;
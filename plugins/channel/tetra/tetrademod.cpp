@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include "tetrademod.h"
 #include "dsp/dspcommands.h"
+#include "util/trace.h"
 
 MessageRegistrator TetraDemod::MsgConfigureTetraDemod::ID("MsgConfigureTetraDemod");
 
@@ -46,6 +47,7 @@ void TetraDemod::configure(MessageQueue* messageQueue)
 
 void TetraDemod::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
+	TRACE_SCOPE("TetraDemod::feed");
 	size_t count = end - begin;
 
 	Complex ci;
@@ -100,6 +102,8 @@ bool TetraDemod::handleMessage(Message* cmd)
 			f = NULL;
 			qDebug("stopped writing samples");
 		}
+		cmd->completed();
+		return true;
 	} else {
 		return false;
 	}
@@ -2,7 +2,7 @@
 #include <QMainWindow>
 #include "tetrademodgui.h"
 #include "ui_tetrademodgui.h"
-#include "dsp/threadedsamplesink.h"
+#include "dsp/decoupledsamplesink.h"
 #include "dsp/channelizer.h"
 #include "tetrademod.h"
 #include "dsp/spectrumvis.h"
@@ -59,7 +59,7 @@ bool TetraDemodGUI::handleMessage(Message* message)
 
 void TetraDemodGUI::viewChanged()
 {
-	m_channelizer->configure(m_threadedSampleSink->getMessageQueue(), 36000, m_channelMarker->getCenterFrequency());
+	m_channelizer->configure(m_channelSink->getMessageQueue(), 36000, m_channelMarker->getCenterFrequency());
 }
 
 TetraDemodGUI::TetraDemodGUI(PluginAPI* pluginAPI, QDockWidget* dockWidget, QWidget* parent) :
@@ -73,14 +73,15 @@ TetraDemodGUI::TetraDemodGUI(PluginAPI* pluginAPI, QDockWidget* dockWidget, QWid
 	m_spectrumVis = new SpectrumVis(ui->glSpectrum);
 	m_tetraDemod = new TetraDemod(m_spectrumVis);
 	m_channelizer = new Channelizer(m_tetraDemod);
-	m_threadedSampleSink = new ThreadedSampleSink(m_channelizer);
-	m_pluginAPI->addSampleSink(m_threadedSampleSink);
+	m_channelSink = m_pluginAPI->createChannelSink(m_channelizer);
+	m_channelSink->setMetricsName(Metrics::instanceName("tetra"));
+	m_pluginAPI->addSampleSink(m_channelSink);
 
 	ui->glSpectrum->setCenterFrequency(0);
 	ui->glSpectrum->setSampleRate(36000);
 	ui->glSpectrum->setDisplayWaterfall(true);
 	ui->glSpectrum->setDisplayMaxHold(true);
-	m_spectrumVis->configure(m_threadedSampleSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
+	m_spectrumVis->configure(m_channelSink->getMessageQueue(), 64, 10, FFTWindow::BlackmanHarris);
 
 	m_channelMarker = new ChannelMarker(this);
 	m_channelMarker->setColor(Qt::darkGreen);
@@ -95,8 +96,8 @@ TetraDemodGUI::TetraDemodGUI(PluginAPI* pluginAPI, QDockWidget* dockWidget, QWid
 
 TetraDemodGUI::~TetraDemodGUI()
 {
-	m_pluginAPI->removeSampleSink(m_threadedSampleSink);
-	delete m_threadedSampleSink;
+	m_pluginAPI->removeSampleSink(m_channelSink);
+	delete m_channelSink;
 	delete m_channelizer;
 	delete m_tetraDemod;
 	delete m_spectrumVis;
@@ -106,5 +107,5 @@ TetraDemodGUI::~TetraDemodGUI()
 
 void TetraDemodGUI::on_test_clicked()
 {
-	m_tetraDemod->configure(m_threadedSampleSink->getMessageQueue());
+	m_tetraDemod->configure(m_channelSink->getMessageQueue());
 }
@@ -8,7 +8,7 @@ class QDockWidget;
 class PluginAPI;
 class ChannelMarker;
 
-class ThreadedSampleSink;
+class DecoupledSampleSink;
 class Channelizer;
 class TetraDemod;
 class SpectrumVis;
@@ -47,7 +47,7 @@ private:
 	QDockWidget* m_dockWidget;
 	ChannelMarker* m_channelMarker;
 
-	ThreadedSampleSink* m_threadedSampleSink;
+	DecoupledSampleSink* m_channelSink;
 	Channelizer* m_channelizer;
 	TetraDemod* m_tetraDemod;
 	SpectrumVis* m_spectrumVis;
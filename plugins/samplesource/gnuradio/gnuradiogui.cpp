@@ -120,6 +120,7 @@ bool GNURadioGui::handleMessage(Message* message)
 		/* insert 0 which will become "Auto" in the combo box */
 		m_bandwidths.insert(m_bandwidths.begin(), 0);
 		displaySettings();
+		message->completed();
 		return true;
 	} else {
 		return false;
@@ -239,6 +239,7 @@ bool GNURadioInput::handleMessage(Message* message)
 		MsgConfigureGNURadio* conf = (MsgConfigureGNURadio*)message;
 		if(!applySettings(conf->getGeneralSettings(), conf->getSettings(), false))
 			qDebug("Gnuradio config error");
+		message->completed();
 		return true;
 	} else {
 		return false;
@@ -19,6 +19,8 @@
 #include <errno.h>
 #include "osmosdrthread.h"
 #include "dsp/samplefifo.h"
+#include "util/threadpolicy.h"
+#include "util/trace.h"
 
 OsmoSDRThread::OsmoSDRThread(osmosdr_dev_t* dev, SampleFifo* sampleFifo, QObject* parent) :
 	QThread(parent),
@@ -52,6 +54,8 @@ void OsmoSDRThread::run()
 {
 	int res;
 
+	ThreadPolicy::apply(ThreadPolicy::TcSource, "sdr-osmosdr");
+
 	m_sampleFifo->readCommit(m_sampleFifo->fill());
 
 	m_running = true;
@@ -90,6 +94,7 @@ void OsmoSDRThread::checkData(const quint8* buf, qint32 len)
 
 void OsmoSDRThread::callback(const quint8* buf, qint32 len)
 {
+	TRACE_SCOPE("OsmoSDRThread::callback");
 	//checkData(buf, len);
 
 	m_sampleFifo->write(buf, len);
@@ -19,6 +19,8 @@
 #include <errno.h>
 #include "rtlsdrthread.h"
 #include "dsp/samplefifo.h"
+#include "util/threadpolicy.h"
+#include "util/trace.h"
 
 #define BLOCKSIZE 16384
 
@@ -61,6 +63,8 @@ void RTLSDRThread::run()
 {
 	int res;
 
+	ThreadPolicy::apply(ThreadPolicy::TcSource, "sdr-rtlsdr");
+
 	m_running = true;
 	m_startWaiter.wakeAll();
 
@@ -132,6 +136,7 @@ void RTLSDRThread::decimate16(SampleVector::iterator* it, const quint8* buf, qin
 
 void RTLSDRThread::callback(const quint8* buf, qint32 len)
 {
+	TRACE_SCOPE("RTLSDRThread::callback");
 	SampleVector::iterator it = m_convertBuffer.begin();
 
 	switch(m_decimation) {
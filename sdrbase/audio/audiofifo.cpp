@@ -18,183 +18,200 @@
 #include <string.h>
 #include <QTime>
 #include "audio/audiofifo.h"
+#include "util/latency.h"
 
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 
 AudioFifo::AudioFifo() :
 	m_fifo(NULL),
+	m_fill(0),
+	m_clearRequested(0),
+	m_writeWaiting(0),
+	m_readWaiting(0),
 	m_sampleRate(0),
-	m_stopped(true)
+	m_stopped(1),
+	m_gain(4096),
+	m_muted(0),
+	m_markerHead(0),
+	m_markerTail(0),
+	m_writeCount(0),
+	m_readCount(0),
+	m_fillMetric(Metric::MtGauge, "sdr_audio_fifo_fill", "Audio samples waiting in an audio FIFO"),
+	m_underrunsMetric(Metric::MtCounter, "sdr_audio_fifo_underruns_total", "Reads an audio FIFO could not serve completely"),
+	m_overrunsMetric(Metric::MtCounter, "sdr_audio_fifo_overruns_total", "Writes an audio FIFO had no room for")
 {
+	m_fillMetric.setSource(&m_fill);
+	setMetricsName(Metrics::instanceName("audio"));
 	m_size = 0;
-	m_fill = 0;
 	m_head = 0;
 	m_tail = 0;
 }
 
 AudioFifo::AudioFifo(uint sampleSize, uint numSamples) :
-	m_fifo(NULL)
+	m_fifo(NULL),
+	m_fill(0),
+	m_clearRequested(0),
+	m_writeWaiting(0),
+	m_readWaiting(0),
+	m_sampleRate(0),
+	m_stopped(1),
+	m_gain(4096),
+	m_muted(0),
+	m_markerHead(0),
+	m_markerTail(0),
+	m_writeCount(0),
+	m_readCount(0),
+	m_fillMetric(Metric::MtGauge, "sdr_audio_fifo_fill", "Audio samples waiting in an audio FIFO"),
+	m_underrunsMetric(Metric::MtCounter, "sdr_audio_fifo_underruns_total", "Reads an audio FIFO could not serve completely"),
+	m_overrunsMetric(Metric::MtCounter, "sdr_audio_fifo_overruns_total", "Writes an audio FIFO had no room for")
 {
-	QMutexLocker mutexLocker(&m_mutex);
-
+	m_fillMetric.setSource(&m_fill);
+	setMetricsName(Metrics::instanceName("audio"));
 	create(sampleSize, numSamples);
 }
 
 AudioFifo::~AudioFifo()
 {
-	QMutexLocker mutexLocker(&m_mutex);
-
 	if(m_fifo != NULL) {
 		delete[] m_fifo;
 		m_fifo = NULL;
 	}
 
-	m_writeWaitCondition.wakeOne();
-	m_readWaitCondition.wakeOne();
+	m_writeWaitCondition.wakeAll();
+	m_readWaitCondition.wakeAll();
 
 	m_size = 0;
 }
 
 bool AudioFifo::setSize(uint sampleSize, uint numSamples)
 {
-	QMutexLocker mutexLocker(&m_mutex);
-
 	return create(sampleSize, numSamples);
 }
 
 uint AudioFifo::write(const quint8* data, uint numSamples, int timeout)
 {
 	QTime time;
-	uint total;
 	uint remaining;
 	uint copyLen;
 
 	if(m_fifo == NULL)
 		return 0;
 
-	time.start();
-	m_mutex.lock();
+	if((numSamples > 0) && Latency::isEnabled())
+		pushMarker();
 
-	if(timeout == 0)
-		total = MIN(numSamples, m_size - m_fill);
-	else total = numSamples;
+	time.start();
 
-	remaining = total;
+	remaining = numSamples;
 	while(remaining > 0) {
-		if(isFull()) {
-			if(time.elapsed() < timeout) {
-				m_writeWaitLock.lock();
-				m_mutex.unlock();
-				int ms = timeout - time.elapsed();
-				if(ms < 1)
-					ms = 1;
-				bool ok = m_writeWaitCondition.wait(&m_writeWaitLock, ms);
-				m_writeWaitLock.unlock();
-				if(!ok)
-					return total - remaining;
-				m_mutex.lock();
-				if(m_fifo == NULL) {
-					m_mutex.unlock();
-					return 0;
-				}
-			} else {
-				m_mutex.unlock();
-				return total - remaining;
-			}
+		uint space = m_size - m_fill.loadAcquire();
+		if(space == 0) {
+			int ms = timeout - time.elapsed();
+			if(ms <= 0)
+				break;
+			m_writeWaitLock.lock();
+			m_writeWaiting.fetchAndStoreOrdered(1);
+			if(isFull())
+				m_writeWaitCondition.wait(&m_writeWaitLock, ms);
+			m_writeWaiting.storeRelease(0);
+			m_writeWaitLock.unlock();
+			continue;
 		}
-		copyLen = MIN(remaining, m_size - m_fill);
+
+		copyLen = MIN(remaining, space);
 		copyLen = MIN(copyLen, m_size - m_tail);
 		memcpy(m_fifo + (m_tail * m_sampleSize), data, copyLen * m_sampleSize);
 		m_tail += copyLen;
 		m_tail %= m_size;
-		m_fill += copyLen;
+		m_fill.fetchAndAddOrdered(copyLen);
 		data += copyLen * m_sampleSize;
 		remaining -= copyLen;
-		m_readWaitCondition.wakeOne();
+		wake(m_readWaiting, m_readWaitLock, m_readWaitCondition);
 	}
 
-	m_mutex.unlock();
-	return total;
+	if(remaining > 0)
+		m_overrunsMetric.add();
+	m_writeCount += numSamples - remaining;
+	return numSamples - remaining;
 }
 
 uint AudioFifo::read(quint8* data, uint numSamples, int timeout)
 {
 	QTime time;
-	uint total;
 	uint remaining;
 	uint copyLen;
 
 	if(m_fifo == NULL)
 		return 0;
 
-	time.start();
-	m_mutex.lock();
+	if(m_clearRequested.testAndSetOrdered(1, 0))
+		drain(fill());
 
-	if(timeout == 0)
-		total = MIN(numSamples, m_fill);
-	else total = numSamples;
+	time.start();
 
-	remaining = total;
+	remaining = numSamples;
 	while(remaining > 0) {
-		if(isEmpty()) {
-			if(time.elapsed() < timeout) {
-				m_readWaitLock.lock();
-				m_mutex.unlock();
-				int ms = timeout - time.elapsed();
-				if(ms < 1)
-					ms = 1;
-				bool ok = m_readWaitCondition.wait(&m_readWaitLock, ms);
-				m_readWaitLock.unlock();
-				if(!ok)
-					return total - remaining;
-				m_mutex.lock();
-				if(m_fifo == NULL) {
-					m_mutex.unlock();
-					return 0;
-				}
-			} else {
-				m_mutex.unlock();
-				return total - remaining;
-			}
+		uint available = m_fill.loadAcquire();
+		if(available == 0) {
+			int ms = timeout - time.elapsed();
+			if(ms <= 0)
+				break;
+			m_readWaitLock.lock();
+			m_readWaiting.fetchAndStoreOrdered(1);
+			if(isEmpty())
+				m_readWaitCondition.wait(&m_readWaitLock, ms);
+			m_readWaiting.storeRelease(0);
+			m_readWaitLock.unlock();
+			continue;
 		}
 
-		copyLen = MIN(remaining, m_fill);
+		copyLen = MIN(remaining, available);
 		copyLen = MIN(copyLen, m_size - m_head);
 		memcpy(data, m_fifo + (m_head * m_sampleSize), copyLen * m_sampleSize);
 		m_head += copyLen;
 		m_head %= m_size;
-		m_fill -= copyLen;
+		m_fill.fetchAndAddOrdered(-(int)copyLen);
 		data += copyLen * m_sampleSize;
 		remaining -= copyLen;
-		m_writeWaitCondition.wakeOne();
+		wake(m_writeWaiting, m_writeWaitLock, m_writeWaitCondition);
 	}
 
-	m_mutex.unlock();
-	return total;
+	if((remaining > 0) && !isStopped())
+		m_underrunsMetric.add();
+	m_readCount += numSamples - remaining;
+	popMarkers(true);
+	return numSamples - remaining;
+}
+
+void AudioFifo::setMetricsName(const QString& name)
+{
+	QString labels = QString("fifo=\"%1\"").arg(name);
+	m_fillMetric.setLabels(labels);
+	m_underrunsMetric.setLabels(labels);
+	m_overrunsMetric.setLabels(labels);
 }
 
 uint AudioFifo::drain(uint numSamples)
 {
-	QMutexLocker mutexLocker(&m_mutex);
+	uint available = fill();
 
-	if(numSamples > m_fill)
-		numSamples = m_fill;
+	if(numSamples > available)
+		numSamples = available;
+	if(numSamples == 0)
+		return 0;
 	m_head = (m_head + numSamples) % m_size;
-	m_fill -= numSamples;
+	m_fill.fetchAndAddOrdered(-(int)numSamples);
+	m_readCount += numSamples;
+	popMarkers(false);
 
-	m_writeWaitCondition.wakeOne();
+	wake(m_writeWaiting, m_writeWaitLock, m_writeWaitCondition);
 	return numSamples;
 }
 
 void AudioFifo::clear()
 {
-	QMutexLocker mutexLocker(&m_mutex);
-
-	m_fill = 0;
-	m_head = 0;
-	m_tail = 0;
-
-	m_writeWaitCondition.wakeOne();
+	// the read position belongs to the reader - let it drop the content
+	m_clearRequested.storeRelease(1);
 }
 
 bool AudioFifo::create(uint sampleSize, uint numSamples)
@@ -206,9 +223,14 @@ bool AudioFifo::create(uint sampleSize, uint numSamples)
 
 	m_sampleSize = sampleSize;
 	m_size = 0;
-	m_fill = 0;
+	m_fill.storeRelease(0);
 	m_head = 0;
 	m_tail = 0;
+	m_clearRequested.storeRelease(0);
+	m_markerHead.storeRelease(0);
+	m_markerTail.storeRelease(0);
+	m_writeCount = 0;
+	m_readCount = 0;
 
 	if((m_fifo = new qint8[numSamples * m_sampleSize]) == NULL) {
 		qDebug("out of memory");
@@ -218,3 +240,59 @@ bool AudioFifo::create(uint sampleSize, uint numSamples)
 	m_size = numSamples;
 	return true;
 }
+
+void AudioFifo::setGain(Real gain)
+{
+	if(gain < 0.0)
+		gain = 0.0;
+	else if(gain > 7.99)
+		gain = 7.99;
+	m_gain.storeRelease((int)(gain * 4096.0));
+}
+
+void AudioFifo::pushMarker()
+{
+	uint tail = m_markerTail.loadAcquire();
+	if(tail - (uint)m_markerHead.loadAcquire() >= MaxMarkers)
+		return; // the reader is behind, this block is accounted to the previous one
+
+	Marker& marker = m_markers[tail % MaxMarkers];
+	marker.m_begin = m_writeCount;
+	marker.m_written = Latency::now();
+	marker.m_origin = Latency::origin();
+	m_markerTail.storeRelease(tail + 1);
+}
+
+void AudioFifo::popMarkers(bool record)
+{
+	// a block counts as played out as soon as its first sample has been read
+	uint head = m_markerHead.loadAcquire();
+	uint tail = m_markerTail.loadAcquire();
+	if(head == tail)
+		return;
+
+	qint64 now = Latency::now();
+	while(head != tail) {
+		const Marker& marker = m_markers[head % MaxMarkers];
+		if(marker.m_begin >= m_readCount)
+			break;
+		if(record && Latency::isEnabled()) {
+			Latency::record(Latency::StAudioFifo, now - marker.m_written);
+			if(marker.m_origin != 0)
+				Latency::record(Latency::StEndToEnd, now - marker.m_origin);
+		}
+		head++;
+	}
+	m_markerHead.storeRelease(head);
+}
+
+void AudioFifo::wake(QAtomicInt& waiting, QMutex& lock, QWaitCondition& condition)
+{
+	// the waiter holds the lock from setting its flag until wait() releases it, so taking the
+	// lock here only blocks for that short moment - and guarantees the wake-up is not lost
+	if(waiting.loadAcquire() == 0)
+		return;
+	lock.lock();
+	condition.wakeAll();
+	lock.unlock();
+}
@@ -16,11 +16,15 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 #include <string.h>
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
 #include <QAudioFormat>
 #include <QAudioDeviceInfo>
 #include <QAudioOutput>
 #include "audio/audiooutput.h"
 #include "audio/audiofifo.h"
+#include "util/trace.h"
 
 AudioOutput::AudioOutput() :
 	m_mutex(),
@@ -155,57 +159,66 @@ bool AudioOutput::open(OpenMode mode)
 
 qint64 AudioOutput::readData(char* data, qint64 maxLen)
 {
+	TRACE_SCOPE("AudioOutput::readData");
 	QMutexLocker mutexLocker(&m_mutex);
 
 	maxLen -= maxLen % 4;
 	int framesPerBuffer = maxLen / 4;
+	int values = framesPerBuffer * 2; // stereo
 
-	if((int)m_mixBuffer.size() < framesPerBuffer * 2) {
-		m_mixBuffer.resize(framesPerBuffer * 2); // allocate 2 qint32 per frame (stereo)
-		if(m_mixBuffer.size() != framesPerBuffer * 2) {
-			qDebug("KAPUTT");
-			return 0;
-		}
-	}
-	memset(&m_mixBuffer[0], 0x00, 2 * framesPerBuffer * sizeof(m_mixBuffer[0])); // start with silence
+	if((int)m_mixBuffer.size() < values)
+		m_mixBuffer.resize(values); // scratch area the fifos are read into
+	qint16* mix = (qint16*)data;
+	memset(mix, 0x00, values * sizeof(qint16)); // start with silence
 
-	// sum up a block from all fifos
+	// sum up a block from all fifos - gain and saturation are applied in the same pass
 	for(AudioFifos::iterator it = m_audioFifos.begin(); it != m_audioFifos.end(); ++it) {
 		if((*it)->isStopped())
 			continue;
-
-		// use outputBuffer as temp - yes, one memcpy could be saved
-		uint samples = (*it)->read((quint8*)data, framesPerBuffer, 1);
-		const qint16* src = (const qint16*)data;
-		std::vector<qint32>::iterator dst = m_mixBuffer.begin();
-		for(uint i = 0; i < samples; i++) {
-			*dst += *src;
-			++src;
-			++dst;
-			*dst += *src;
-			++src;
-			++dst;
+		if((*it)->isMuted()) {
+			(*it)->drain(framesPerBuffer);
+			continue;
 		}
-	}
 
-	// convert to int16 and do saturation
-	std::vector<qint32>::const_iterator src = m_mixBuffer.begin();
-	qint16* dst = (qint16*)data;
-	for(int i = 0; i < framesPerBuffer; ++i) {
-		// left channel
-		qint32 s = *src++;
-		if(s < -32768)
-			s = -32768;
-		else if(s > 32767)
-			s = 32767;
-		*dst++ = s;
-		// right channel
-		s = *src++;
-		if(s < -32768)
-			s = -32768;
-		else if(s > 32767)
-			s = 32767;
-		*dst++ = s;
+		int samples = (*it)->read((quint8*)&m_mixBuffer[0], framesPerBuffer, 0) * 2;
+		const qint16* src = &m_mixBuffer[0];
+		qint32 gain = (*it)->getFixedGain();
+		int i = 0;
+
+#ifdef USE_SIMD
+		if(gain == 4096) {
+			for(; i + 8 <= samples; i += 8) {
+				__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+				__m128i d = _mm_loadu_si128((const __m128i*)(mix + i));
+				_mm_storeu_si128((__m128i*)(mix + i), _mm_adds_epi16(d, s));
+			}
+		} else {
+			const __m128i g = _mm_set1_epi16(gain);
+			for(; i + 8 <= samples; i += 8) {
+				__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+				__m128i lo = _mm_mullo_epi16(s, g);
+				__m128i hi = _mm_mulhi_epi16(s, g);
+				__m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 12);
+				__m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 12);
+				__m128i d = _mm_loadu_si128((const __m128i*)(mix + i));
+				_mm_storeu_si128((__m128i*)(mix + i), _mm_adds_epi16(d, _mm_packs_epi32(p0, p1)));
+			}
+		}
+#endif
+
+		for(; i < samples; i++) {
+			qint32 s = (src[i] * gain) >> 12;
+			if(s < -32768)
+				s = -32768;
+			else if(s > 32767)
+				s = 32767;
+			s += mix[i];
+			if(s < -32768)
+				s = -32768;
+			else if(s > 32767)
+				s = 32767;
+			mix[i] = s;
+		}
 	}
 
 	return framesPerBuffer * 4;
@@ -0,0 +1,208 @@
+#define _USE_MATH_DEFINES
+#include <math.h>
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+#include "dsp/audioresampler.h"
+#include "audio/audiofifo.h"
+
+AudioResampler::AudioResampler(AudioFifo* audioFifo) :
+	m_audioFifo(audioFifo),
+	m_inputSampleRate(0),
+	m_outputSampleRate(0),
+	m_targetLatency(100),
+	m_targetFill(0),
+	m_pid(),
+	m_fillAverage(0),
+	m_correction(0),
+	m_regulateCount(0),
+	m_distance(1.0),
+	m_distanceRemain(0),
+	m_taps(),
+	m_history(2 * Taps, 0),
+	m_historyPos(0),
+	m_buffer(4096),
+	m_bufferFill(0)
+{
+	// time constant of about 10s, the integral part takes over the static clock offset
+	m_pid.setup(0.01, 0.0000025, 0.0);
+}
+
+void AudioResampler::configure(int inputSampleRate, int outputSampleRate)
+{
+	if((inputSampleRate == m_inputSampleRate) && (outputSampleRate == m_outputSampleRate))
+		return;
+
+	m_inputSampleRate = inputSampleRate;
+	m_outputSampleRate = outputSampleRate;
+	if((m_inputSampleRate > 0) && (m_outputSampleRate > 0))
+		m_distance = (Real)m_inputSampleRate / (Real)m_outputSampleRate;
+	else m_distance = 1.0;
+
+	setTargetLatency(m_targetLatency);
+	createTaps();
+}
+
+void AudioResampler::setTargetLatency(int ms)
+{
+	m_targetLatency = ms;
+	m_targetFill = ((Real)m_targetLatency * m_outputSampleRate) / 1000.0;
+	if(m_targetFill > m_audioFifo->size() / 2)
+		m_targetFill = m_audioFifo->size() / 2;
+	if(m_targetFill < 1)
+		m_targetFill = 1;
+}
+
+void AudioResampler::reset()
+{
+	// no clear() here: it is carried out by the next read, which would be the first one after
+	// priming. Leftover audio only shortens the priming and is regulated away afterwards.
+	m_audioFifo->setStopped(true);
+	m_pid.reset();
+	m_correction = 0;
+	m_regulateCount = 0;
+	m_distanceRemain = 0;
+	m_bufferFill = 0;
+	for(uint i = 0; i < m_history.size(); i++)
+		m_history[i] = 0;
+	m_historyPos = 0;
+}
+
+void AudioResampler::feed(const Real* samples, uint count)
+{
+	if((m_audioFifo->size() == 0) || (m_outputSampleRate == 0) || m_taps.empty())
+		return;
+
+	uint regulateInterval = m_outputSampleRate / 100;
+	Real step = m_distance * (1.0 + m_correction);
+
+	for(uint i = 0; i < count; i++) {
+		m_history[m_historyPos] = samples[i];
+		m_history[m_historyPos + Taps] = samples[i];
+		m_historyPos = (m_historyPos + 1) % Taps;
+
+		while(m_distanceRemain < 1.0) {
+			Real v = interpolate(m_distanceRemain) * 32767.0;
+			qint16 s;
+			if(v > 32767.0)
+				s = 32767;
+			else if(v < -32768.0)
+				s = -32768;
+			else s = v;
+			m_buffer[m_bufferFill].l = s;
+			m_buffer[m_bufferFill].r = s;
+			if(++m_bufferFill >= m_buffer.size())
+				flush();
+
+			m_distanceRemain += step;
+
+			// the loop runs every 10ms of output so its gains do not depend on the block size
+			if(++m_regulateCount >= regulateInterval) {
+				m_regulateCount = 0;
+				regulate();
+				step = m_distance * (1.0 + m_correction);
+			}
+		}
+		m_distanceRemain -= 1.0;
+	}
+
+	flush();
+}
+
+void AudioResampler::createTaps()
+{
+	// cutoff relative to the input rate, leave some room below the lower nyquist frequency
+	Real fc = 0.45;
+	if(m_distance > 1.0)
+		fc /= m_distance;
+
+	m_taps.resize((PhaseSteps + 1) * Taps);
+	for(int p = 0; p <= PhaseSteps; p++) {
+		Real* h = &m_taps[p * Taps];
+		Real frac = (Real)p / (Real)PhaseSteps;
+		Real sum = 0;
+		for(int k = 0; k < Taps; k++) {
+			// distance of tap k (0 = oldest sample) from the output instant
+			double t = Taps / 2 - 1 + frac - k;
+			double sinc = (t == 0.0) ? 1.0 : sin(2.0 * M_PI * fc * t) / (2.0 * M_PI * fc * t);
+			double window = 0.42 + 0.5 * cos(2.0 * M_PI * t / Taps) + 0.08 * cos(4.0 * M_PI * t / Taps);
+			h[k] = sinc * window;
+			sum += h[k];
+		}
+		for(int k = 0; k < Taps; k++)
+			h[k] /= sum;
+	}
+}
+
+void AudioResampler::regulate()
+{
+	Real fill = m_audioFifo->fill();
+
+	if(m_audioFifo->isStopped()) {
+		// prime the fifo up to the target before the audio device starts pulling
+		if(fill >= m_targetFill) {
+			m_audioFifo->setStopped(false);
+			m_pid.reset();
+			m_fillAverage = fill;
+			m_correction = 0;
+		}
+		return;
+	}
+
+	// the fill level jumps with every read of the audio device - smooth it over about 0.5s
+	m_fillAverage += (fill - m_fillAverage) * 0.02;
+
+	// too much audio buffered -> consume the input faster (produce fewer output samples)
+	m_correction = m_pid.feed((m_fillAverage - m_targetFill) / m_targetFill);
+	if(m_correction > 0.005)
+		m_correction = 0.005;
+	else if(m_correction < -0.005)
+		m_correction = -0.005;
+}
+
+void AudioResampler::flush()
+{
+	if(m_bufferFill == 0)
+		return;
+
+	uint res = m_audioFifo->write((const quint8*)&m_buffer[0], m_bufferFill, 0);
+	if(res != m_bufferFill)
+		qDebug("AudioResampler: lost %u audio samples", m_bufferFill - res);
+	m_bufferFill = 0;
+}
+
+Real AudioResampler::interpolate(Real frac)
+{
+	// linear interpolation between the two neighbouring phases
+	Real pos = frac * PhaseSteps;
+	int phase = (int)pos;
+	Real mu = pos - phase;
+	const Real* x = &m_history[m_historyPos];
+	const Real* h0 = &m_taps[phase * Taps];
+	const Real* h1 = h0 + Taps;
+
+#ifdef USE_SIMD
+	__m128 s0 = _mm_setzero_ps();
+	__m128 s1 = _mm_setzero_ps();
+	for(int k = 0; k < Taps; k += 4) {
+		__m128 v = _mm_loadu_ps(x + k);
+		s0 = _mm_add_ps(s0, _mm_mul_ps(v, _mm_loadu_ps(h0 + k)));
+		s1 = _mm_add_ps(s1, _mm_mul_ps(v, _mm_loadu_ps(h1 + k)));
+	}
+	float r0[4];
+	float r1[4];
+	_mm_storeu_ps(r0, s0);
+	_mm_storeu_ps(r1, s1);
+	Real y0 = r0[0] + r0[1] + r0[2] + r0[3];
+	Real y1 = r1[0] + r1[1] + r1[2] + r1[3];
+#else
+	Real y0 = 0;
+	Real y1 = 0;
+	for(int k = 0; k < Taps; k++) {
+		y0 += x[k] * h0[k];
+		y1 += x[k] * h1[k];
+	}
+#endif
+
+	return y0 + mu * (y1 - y0);
+}
@@ -1,6 +1,8 @@
 #include "dsp/channelizer.h"
 #include "dsp/inthalfbandfilter.h"
 #include "dsp/dspcommands.h"
+#include "util/latency.h"
+#include "util/trace.h"
 
 Channelizer::Channelizer(SampleSink* sampleSink) :
 	m_sampleSink(sampleSink),
@@ -25,6 +27,9 @@ void Channelizer::configure(MessageQueue* messageQueue, int sampleRate, int cent
 
 void Channelizer::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
+	TRACE_SCOPE("Channelizer::feed");
+	qint64 startTime = Latency::isEnabled() ? Latency::now() : 0;
+
 	for(SampleVector::const_iterator sample = begin; sample != end; ++sample) {
 		Sample s(*sample);
 		bool haveSample = true;
@@ -39,9 +44,18 @@ void Channelizer::feed(SampleVector::const_iterator begin, SampleVector::const_i
 			m_sampleBuffer.push_back(s);
 	}
 
-	if(m_sampleSink != NULL)
+	if(startTime != 0) {
+		// the demodulator is timed separately so its share can be told apart from the filter chain
+		qint64 filterTime = Latency::now();
+		Latency::record(Latency::StChannelizer, filterTime - startTime);
+		if(m_sampleSink != NULL)
+			m_sampleSink->feed(m_sampleBuffer.begin(), m_sampleBuffer.end(), firstOfBurst);
+		Latency::record(Latency::StDemod, Latency::now() - filterTime);
+	} else if(m_sampleSink != NULL) {
 		m_sampleSink->feed(m_sampleBuffer.begin(), m_sampleBuffer.end(), firstOfBurst);
+	}
 
+	m_profile.addOutput(m_sampleBuffer.size());
 	m_sampleBuffer.clear();
 }
 
@@ -13,8 +13,10 @@ MESSAGE_CLASS_DEFINITION(DSPAddAudioSource, Message)
 MESSAGE_CLASS_DEFINITION(DSPRemoveAudioSource, Message)
 MESSAGE_CLASS_DEFINITION(DSPConfigureSpectrumVis, Message)
 MESSAGE_CLASS_DEFINITION(DSPConfigureCorrection, Message)
+MESSAGE_CLASS_DEFINITION(DSPConfigurePipeline, Message)
 MESSAGE_CLASS_DEFINITION(DSPConfigureAudioOutput, Message)
 MESSAGE_CLASS_DEFINITION(DSPEngineReport, Message)
 MESSAGE_CLASS_DEFINITION(DSPConfigureScopeVis, Message)
 MESSAGE_CLASS_DEFINITION(DSPSignalNotification, Message)
+MESSAGE_CLASS_DEFINITION(DSPOverloadNotification, Message)
 MESSAGE_CLASS_DEFINITION(DSPConfigureChannelizer, Message)
@@ -20,16 +20,28 @@
 #include "dsp/channelizer.h"
 #include "dsp/samplefifo.h"
 #include "dsp/samplesink.h"
+#include "dsp/pooledsamplesink.h"
+#include "dsp/threadedsamplesink.h"
 #include "dsp/dspcommands.h"
 #include "dsp/samplesource/samplesource.h"
+#include "util/latency.h"
+#include "util/threadpolicy.h"
+#include "util/trace.h"
 
 DSPEngine::DSPEngine(MessageQueue* reportQueue, QObject* parent) :
 	QThread(parent),
 	m_messageQueue(),
 	m_reportQueue(reportQueue),
+	m_dispatcher(),
 	m_state(StNotStarted),
 	m_sampleSource(NULL),
 	m_sampleSinks(),
+	m_mainSpectrumSink(NULL),
+	m_pipeline(this),
+	m_scheduler(),
+	m_overload(),
+	m_sinkWorkerPool(),
+	m_pooledChannelSinks(true),
 	m_sampleRate(0),
 	m_centerFrequency(0),
 	m_dcOffsetCorrection(false),
@@ -40,7 +52,23 @@ DSPEngine::DSPEngine(MessageQueue* reportQueue, QObject* parent) :
 	m_qRange(1 << 16),
 	m_imbalance(65536)
 {
+	m_messageQueue.setMetricsName("engine");
 	moveToThread(this);
+
+	m_dispatcher.add(DSPPing::typeId(), &DSPEngine::handlePing);
+	m_dispatcher.add(DSPExit::typeId(), &DSPEngine::handleExit);
+	m_dispatcher.add(DSPAcquisitionStart::typeId(), &DSPEngine::handleAcquisitionStart);
+	m_dispatcher.add(DSPAcquisitionStop::typeId(), &DSPEngine::handleAcquisitionStop);
+	m_dispatcher.add(DSPGetDeviceDescription::typeId(), &DSPEngine::handleGetDeviceDescription);
+	m_dispatcher.add(DSPGetErrorMessage::typeId(), &DSPEngine::handleGetErrorMessage);
+	m_dispatcher.add(DSPSetSource::typeId(), &DSPEngine::handleSetSource);
+	m_dispatcher.add(DSPAddSink::typeId(), &DSPEngine::handleAddSink);
+	m_dispatcher.add(DSPRemoveSink::typeId(), &DSPEngine::handleRemoveSink);
+	m_dispatcher.add(DSPAddAudioSource::typeId(), &DSPEngine::handleAddAudioSource);
+	m_dispatcher.add(DSPRemoveAudioSource::typeId(), &DSPEngine::handleRemoveAudioSource);
+	m_dispatcher.add(DSPConfigureAudioOutput::typeId(), &DSPEngine::handleConfigureAudioOutput);
+	m_dispatcher.add(DSPConfigureCorrection::typeId(), &DSPEngine::handleConfigureCorrection);
+	m_dispatcher.add(DSPConfigurePipeline::typeId(), &DSPEngine::handleConfigurePipeline);
 }
 
 DSPEngine::~DSPEngine()
@@ -51,6 +79,7 @@ DSPEngine::~DSPEngine()
 void DSPEngine::start()
 {
 	DSPPing cmd;
+	m_sinkWorkerPool.start();
 	QThread::start();
 	cmd.execute(&m_messageQueue);
 }
@@ -59,6 +88,14 @@ void DSPEngine::stop()
 {
 	DSPExit cmd;
 	cmd.execute(&m_messageQueue);
+	m_sinkWorkerPool.stop();
+}
+
+DecoupledSampleSink* DSPEngine::createChannelSink(SampleSink* sampleSink)
+{
+	if(m_pooledChannelSinks)
+		return new PooledSampleSink(&m_sinkWorkerPool, sampleSink);
+	else return new ThreadedSampleSink(sampleSink);
 }
 
 bool DSPEngine::startAcquisition()
@@ -67,6 +104,12 @@ bool DSPEngine::startAcquisition()
 	return cmd.execute(&m_messageQueue) == StRunning;
 }
 
+void DSPEngine::startAcquisition(MessageQueue* replyQueue)
+{
+	Message* cmd = DSPAcquisitionStart::create();
+	cmd->submitWithReply(&m_messageQueue, replyQueue);
+}
+
 void DSPEngine::stopAcquistion()
 {
 	DSPAcquisitionStop cmd;
@@ -79,26 +122,37 @@ void DSPEngine::setSource(SampleSource* source)
 	cmd.execute(&m_messageQueue);
 }
 
-void DSPEngine::addSink(SampleSink* sink)
+void DSPEngine::addSink(SampleSink* sink, bool mainSpectrum)
 {
-	DSPAddSink cmd(sink);
-	cmd.execute(&m_messageQueue);
+	// the GUI does not wait for a busy engine, it adds the sink once it gets to the message
+	DSPAddSink* cmd = new DSPAddSink(sink, mainSpectrum);
+	if(!cmd->tryExecute(&m_messageQueue, AddTimeoutMs)) {
+		qDebug("DSPEngine: engine busy, sink is added in the background");
+		return;
+	}
+	delete cmd;
 }
 
 void DSPEngine::removeSink(SampleSink* sink)
 {
+	// blocks: the caller destroys the sink right after
 	DSPRemoveSink cmd(sink);
 	cmd.execute(&m_messageQueue);
 }
 
 void DSPEngine::addAudioSource(AudioFifo* audioFifo)
 {
-	DSPAddAudioSource cmd(audioFifo);
-	cmd.execute(&m_messageQueue);
+	DSPAddAudioSource* cmd = new DSPAddAudioSource(audioFifo);
+	if(!cmd->tryExecute(&m_messageQueue, AddTimeoutMs)) {
+		qDebug("DSPEngine: engine busy, audio source is added in the background");
+		return;
+	}
+	delete cmd;
 }
 
 void DSPEngine::removeAudioSource(AudioFifo* audioFifo)
 {
+	// blocks: the caller destroys the fifo right after
 	DSPRemoveAudioSource cmd(audioFifo);
 	cmd.execute(&m_messageQueue);
 }
@@ -109,6 +163,12 @@ void DSPEngine::configureCorrections(bool dcOffsetCorrection, bool iqImbalanceCo
 	cmd->submit(&m_messageQueue);
 }
 
+void DSPEngine::configurePipeline(bool pipelined)
+{
+	Message* cmd = DSPConfigurePipeline::create(pipelined);
+	cmd->submit(&m_messageQueue);
+}
+
 void DSPEngine::configureAudioOutput(const QString& audioOutput, quint32 audioOutputRate)
 {
 	Message* cmd = DSPConfigureAudioOutput::create(audioOutput, audioOutputRate);
@@ -131,6 +191,8 @@ QString DSPEngine::deviceDescription()
 
 void DSPEngine::run()
 {
+	ThreadPolicy::apply(ThreadPolicy::TcEngine, "sdr-engine");
+
 	connect(&m_messageQueue, SIGNAL(messageEnqueued()), this, SLOT(handleMessages()), Qt::QueuedConnection);
 
 	m_state = StIdle;
@@ -201,49 +263,151 @@ void DSPEngine::imbalance(SampleVector::iterator begin, SampleVector::iterator e
 		it->m_imag = (it->m_imag * m_imbalance) >> 16;
 }
 
+void DSPEngine::correct(SampleVector::iterator begin, SampleVector::iterator end)
+{
+	if(m_dcOffsetCorrection)
+		dcOffset(begin, end);
+	if(m_iqImbalanceCorrection)
+		imbalance(begin, end);
+}
+
 void DSPEngine::work()
 {
+	TRACE_SCOPE("DSPEngine::work");
+
+	if(m_pipeline.isRunning()) {
+		workPipelined();
+		return;
+	}
+
 	SampleFifo* sampleFifo = m_sampleSource->getSampleFifo();
-	size_t samplesDone = 0;
-	bool firstOfBurst = true;
 
-	while((sampleFifo->fill() > 0) && (m_messageQueue.countPending() == 0) && (samplesDone < m_sampleRate / 2)) {
+	shedBacklog(sampleFifo);
+	m_scheduler.beginBurst();
+	while(continueBurst(sampleFifo)) {
 		SampleVector::iterator part1begin;
 		SampleVector::iterator part1end;
 		SampleVector::iterator part2begin;
 		SampleVector::iterator part2end;
 
-		size_t count = sampleFifo->readBegin(sampleFifo->fill(), &part1begin, &part1end, &part2begin, &part2end);
+		m_scheduler.beginQuantum();
+		size_t count = sampleFifo->readBegin(qMin(sampleFifo->fill(), m_scheduler.quantumSize()), &part1begin, &part1end, &part2begin, &part2end);
+		// the sinks learn about dropped samples in-band, with the first block after the gap
+		bool firstOfBurst = sampleFifo->readAfterGap();
+		qint64 startTime = Latency::isEnabled() ? Latency::now() : 0;
 
 		// first part of FIFO data
 		if(part1begin != part1end) {
 			// correct stuff
-			if(m_dcOffsetCorrection)
-				dcOffset(part1begin, part1end);
-			if(m_iqImbalanceCorrection)
-				imbalance(part1begin, part1end);
+			correct(part1begin, part1end);
 			// feed data to handlers
 			for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); ++it)
-				(*it)->feed(part1begin, part1end, firstOfBurst);
+				(*it)->profiledFeed(part1begin, part1end, firstOfBurst);
 			firstOfBurst = false;
 		}
 		// second part of FIFO data (used when block wraps around)
 		if(part2begin != part2end) {
 			// correct stuff
-			if(m_dcOffsetCorrection)
-				dcOffset(part2begin, part2end);
-			if(m_iqImbalanceCorrection)
-				imbalance(part2begin, part2end);
+			correct(part2begin, part2end);
 			// feed data to handlers
 			for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); ++it)
-				(*it)->feed(part2begin, part2end, firstOfBurst);
+				(*it)->profiledFeed(part2begin, part2end, firstOfBurst);
 			firstOfBurst = false;
 		}
 
+		if(startTime != 0)
+			Latency::record(Latency::StEngine, Latency::now() - startTime);
+
 		// adjust FIFO pointers
 		sampleFifo->readCommit(count);
-		samplesDone += count;
+		m_scheduler.endQuantum(count, sampleFifo->fill());
+	}
+
+	updateOverload(sampleFifo);
+}
+
+void DSPEngine::workPipelined()
+{
+	SampleFifo* sampleFifo = m_sampleSource->getSampleFifo();
+
+	// only copy the samples out of the source fifo here, the stages do the rest
+	shedBacklog(sampleFifo);
+	m_scheduler.beginBurst();
+	while(continueBurst(sampleFifo)) {
+		// when the pipeline is full the data waits in the source fifo until the next dataReady()
+		DSPPipeline::Block* block = m_pipeline.acquireBlock();
+		if(block == NULL)
+			break;
+
+		SampleVector::iterator part1begin;
+		SampleVector::iterator part1end;
+		SampleVector::iterator part2begin;
+		SampleVector::iterator part2end;
+
+		m_scheduler.beginQuantum();
+		size_t count = sampleFifo->readBegin(qMin<uint>(sampleFifo->fill(), qMin<uint>(m_scheduler.quantumSize(), DSPPipeline::BlockSize)), &part1begin, &part1end, &part2begin, &part2end);
+		SampleVector::iterator it = std::copy(part1begin, part1end, block->m_samples.begin());
+		std::copy(part2begin, part2end, it);
+		sampleFifo->readCommit(count);
+
+		block->m_count = count;
+		block->m_firstOfBurst = sampleFifo->readAfterGap();
+		block->m_origin = Latency::isEnabled() ? Latency::origin() : 0;
+		block->m_read = Latency::isEnabled() ? Latency::now() : 0;
+		m_pipeline.push(block);
+
+		m_scheduler.endQuantum(count, sampleFifo->fill());
 	}
+
+	updateOverload(sampleFifo);
+}
+
+bool DSPEngine::continueBurst(SampleFifo* sampleFifo)
+{
+	if(sampleFifo->fill() == 0)
+		return false;
+
+	// control messages go first, a retune has to wait for one quantum at most
+	if((m_messageQueue.countPending() > 0) || m_scheduler.budgetExhausted()) {
+		// come back for the rest once the event loop had its turn
+		QMetaObject::invokeMethod(this, "handleData", Qt::QueuedConnection);
+		return false;
+	}
+	return true;
+}
+
+void DSPEngine::shedBacklog(SampleFifo* sampleFifo)
+{
+	if(m_overload.getLevel() < OverloadController::OlDropSamples)
+		return;
+
+	// last resort: keep a few quanta of the newest samples and skip the rest in whole quanta
+	uint quantum = m_scheduler.quantumSize();
+	uint keep = quantum * 4;
+	if(sampleFifo->fill() <= keep)
+		return;
+	sampleFifo->skip(((sampleFifo->fill() - keep) / quantum) * quantum);
+}
+
+void DSPEngine::updateOverload(SampleFifo* sampleFifo)
+{
+	if(m_overload.update(sampleFifo->fill(), sampleFifo->size(), m_scheduler.getLoad()))
+		notifyOverload();
+}
+
+void DSPEngine::notifyOverload()
+{
+	for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); it++) {
+		DSPOverloadNotification* notification = DSPOverloadNotification::create(m_overload.getLevel());
+		notification->submit(&m_messageQueue, *it);
+	}
+}
+
+void DSPEngine::drainPipeline()
+{
+	// sinks and the correction state belong to the stage threads while blocks are in flight
+	if(m_pipeline.isRunning())
+		m_pipeline.drain();
 }
 
 DSPEngine::State DSPEngine::gotoIdle()
@@ -263,6 +427,7 @@ DSPEngine::State DSPEngine::gotoIdle()
 	if(m_sampleSource == NULL)
 		return StIdle;
 
+	drainPipeline();
 	for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); it++)
 		(*it)->stop();
 	m_sampleSource->stopInput();
@@ -308,6 +473,11 @@ DSPEngine::State DSPEngine::gotoRunning()
 		(*it)->start();
 	m_sampleRate = 0; // make sure, report is sent
 	generateReport();
+	// every run starts at full quality
+	if(m_overload.getLevel() != OverloadController::OlNone) {
+		m_overload.reset();
+		notifyOverload();
+	}
 
 	return StRunning;
 }
@@ -326,8 +496,10 @@ void DSPEngine::handleSetSource(SampleSource* source)
 	if(m_sampleSource != NULL)
 		disconnect(m_sampleSource->getSampleFifo(), SIGNAL(dataReady()), this, SLOT(handleData()));
 	m_sampleSource = source;
-	if(m_sampleSource != NULL)
+	if(m_sampleSource != NULL) {
 		connect(m_sampleSource->getSampleFifo(), SIGNAL(dataReady()), this, SLOT(handleData()), Qt::QueuedConnection);
+		m_sampleSource->getSampleFifo()->setMetricsName("source");
+	}
 	generateReport();
 }
 
@@ -347,6 +519,7 @@ void DSPEngine::generateReport()
 
 	if(sampleRate != m_sampleRate) {
 		m_sampleRate = sampleRate;
+		m_scheduler.setSampleRate(m_sampleRate);
 		needReport = true;
 		for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); it++) {
 			DSPSignalNotification* signal = DSPSignalNotification::create(m_sampleRate, 0);
@@ -376,6 +549,9 @@ bool DSPEngine::distributeMessage(Message* message)
 	}
 	for(SampleSinks::const_iterator it = m_sampleSinks.begin(); it != m_sampleSinks.end(); it++) {
 		if((message->getDestination() == NULL) || (message->getDestination() == *it)) {
+			// sinks the stages call directly must not see a message while they are fed
+			if(!(*it)->queuesMessages())
+				drainPipeline();
 			if((*it)->handleMessage(message))
 				return true;
 		}
@@ -394,73 +570,132 @@ void DSPEngine::handleMessages()
 	Message* message;
 	while((message = m_messageQueue.accept()) != NULL) {
 		//qDebug("Message: %s", message->getIdentifier());
-
-		if(DSPPing::match(message)) {
-			message->completed(m_state);
-		} else if(DSPExit::match(message)) {
-			gotoIdle();
-			m_state = StNotStarted;
-			exit();
-			message->completed(m_state);
-		} else if(DSPAcquisitionStart::match(message)) {
-			m_state = gotoIdle();
-			if(m_state == StIdle)
-				m_state = gotoRunning();
-			message->completed(m_state);
-		} else if(DSPAcquisitionStop::match(message)) {
-			m_state = gotoIdle();
-			message->completed(m_state);
-		} else if(DSPGetDeviceDescription::match(message)) {
-			DSPGetDeviceDescription::cast(message)->setDeviceDescription(m_deviceDescription);
-			message->completed();
-		} else if(DSPGetErrorMessage::match(message)) {
-			((DSPGetErrorMessage*)message)->setErrorMessage(m_errorMessage);
-			message->completed();
-		} else if(DSPSetSource::match(message)) {
-			handleSetSource(DSPSetSource::cast(message)->getSampleSource());
-			message->completed();
-		} else if(DSPAddSink::match(message)) {
-			SampleSink* sink = DSPAddSink::cast(message)->getSampleSink();
-			if(m_state == StRunning) {
-				DSPSignalNotification* signal = DSPSignalNotification::create(m_sampleRate, 0);
-				signal->submit(&m_messageQueue, sink);
-				sink->start();
-			}
-			m_sampleSinks.push_back(sink);
-			message->completed();
-		} else if(DSPRemoveSink::match(message)) {
-			SampleSink* sink = ((DSPAddSink*)message)->getSampleSink();
-			if(m_state == StRunning)
-				sink->stop();
-			m_sampleSinks.remove(sink);
-			message->completed();
-		} else if(DSPAddAudioSource::match(message)) {
-			m_audioOutput.addFifo(DSPAddAudioSource::cast(message)->getAudioFifo());
-			message->completed();
-		} else if(DSPRemoveAudioSource::match(message)) {
-			m_audioOutput.removeFifo(((DSPAddAudioSource*)message)->getAudioFifo());
-			message->completed();
-		} else if(DSPConfigureAudioOutput::match(message)) {
-			DSPConfigureAudioOutput* conf = DSPConfigureAudioOutput::cast(message);
-			m_audioOutput.configure(conf->getAudioOutputDevice(), conf->getAudioOutputRate());
-		} else if(DSPConfigureCorrection::match(message)) {
-			DSPConfigureCorrection* conf = DSPConfigureCorrection::cast(message);
-			m_iqImbalanceCorrection = conf->getIQImbalanceCorrection();
-			if(m_dcOffsetCorrection != conf->getDCOffsetCorrection()) {
-				m_dcOffsetCorrection = conf->getDCOffsetCorrection();
-				m_iOffset = 0;
-				m_qOffset = 0;
-			}
-			if(m_iqImbalanceCorrection != conf->getIQImbalanceCorrection()) {
-				m_iqImbalanceCorrection = conf->getIQImbalanceCorrection();
-				m_iRange = 1 << 16;
-				m_qRange = 1 << 16;
-				m_imbalance = 65536;
-			}
-			message->completed();
-		} else {
+		if(!m_dispatcher.dispatch(this, message)) {
 			if(!distributeMessage(message))
 				message->completed();
 		}
 	}
 }
+
+void DSPEngine::handlePing(Message* message)
+{
+	message->completed(m_state);
+}
+
+void DSPEngine::handleExit(Message* message)
+{
+	gotoIdle();
+	m_pipeline.stop();
+	m_state = StNotStarted;
+	exit();
+	message->completed(m_state);
+}
+
+void DSPEngine::handleAcquisitionStart(Message* message)
+{
+	m_state = gotoIdle();
+	if(m_state == StIdle)
+		m_state = gotoRunning();
+	message->completed(m_state);
+}
+
+void DSPEngine::handleAcquisitionStop(Message* message)
+{
+	m_state = gotoIdle();
+	message->completed(m_state);
+}
+
+void DSPEngine::handleGetDeviceDescription(Message* message)
+{
+	DSPGetDeviceDescription::cast(message)->setDeviceDescription(m_deviceDescription);
+	message->completed();
+}
+
+void DSPEngine::handleGetErrorMessage(Message* message)
+{
+	DSPGetErrorMessage::cast(message)->setErrorMessage(m_errorMessage);
+	message->completed();
+}
+
+void DSPEngine::handleSetSource(Message* message)
+{
+	handleSetSource(DSPSetSource::cast(message)->getSampleSource());
+	message->completed();
+}
+
+void DSPEngine::handleAddSink(Message* message)
+{
+	SampleSink* sink = DSPAddSink::cast(message)->getSampleSink();
+	drainPipeline();
+	if(DSPAddSink::cast(message)->getMainSpectrum())
+		m_mainSpectrumSink = sink;
+	if(m_state == StRunning) {
+		DSPSignalNotification* signal = DSPSignalNotification::create(m_sampleRate, 0);
+		signal->submit(&m_messageQueue, sink);
+		sink->start();
+	}
+	if(m_overload.getLevel() != OverloadController::OlNone) {
+		DSPOverloadNotification* notification = DSPOverloadNotification::create(m_overload.getLevel());
+		notification->submit(&m_messageQueue, sink);
+	}
+	m_sampleSinks.push_back(sink);
+	message->completed();
+}
+
+void DSPEngine::handleRemoveSink(Message* message)
+{
+	SampleSink* sink = DSPRemoveSink::cast(message)->getSampleSink();
+	drainPipeline();
+	if(m_state == StRunning)
+		sink->stop();
+	m_sampleSinks.remove(sink);
+	if(sink == m_mainSpectrumSink)
+		m_mainSpectrumSink = NULL;
+	message->completed();
+}
+
+void DSPEngine::handleAddAudioSource(Message* message)
+{
+	m_audioOutput.addFifo(DSPAddAudioSource::cast(message)->getAudioFifo());
+	message->completed();
+}
+
+void DSPEngine::handleRemoveAudioSource(Message* message)
+{
+	m_audioOutput.removeFifo(DSPRemoveAudioSource::cast(message)->getAudioFifo());
+	message->completed();
+}
+
+void DSPEngine::handleConfigureAudioOutput(Message* message)
+{
+	DSPConfigureAudioOutput* conf = DSPConfigureAudioOutput::cast(message);
+	m_audioOutput.configure(conf->getAudioOutputDevice(), conf->getAudioOutputRate());
+	message->completed();
+}
+
+void DSPEngine::handleConfigureCorrection(Message* message)
+{
+	DSPConfigureCorrection* conf = DSPConfigureCorrection::cast(message);
+	drainPipeline();
+	m_iqImbalanceCorrection = conf->getIQImbalanceCorrection();
+	if(m_dcOffsetCorrection != conf->getDCOffsetCorrection()) {
+		m_dcOffsetCorrection = conf->getDCOffsetCorrection();
+		m_iOffset = 0;
+		m_qOffset = 0;
+	}
+	if(m_iqImbalanceCorrection != conf->getIQImbalanceCorrection()) {
+		m_iqImbalanceCorrection = conf->getIQImbalanceCorrection();
+		m_iRange = 1 << 16;
+		m_qRange = 1 << 16;
+		m_imbalance = 65536;
+	}
+	message->completed();
+}
+
+void DSPEngine::handleConfigurePipeline(Message* message)
+{
+	if(DSPConfigurePipeline::cast(message)->getPipelined())
+		m_pipeline.start();
+	else m_pipeline.stop();
+	message->completed();
+}
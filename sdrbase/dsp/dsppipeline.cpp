@@ -0,0 +1,166 @@
+#include "dsp/dsppipeline.h"
+#include "dsp/dspengine.h"
+#include "dsp/samplesink.h"
+#include "util/latency.h"
+#include "util/threadpolicy.h"
+
+DSPPipeline::Queue::Queue() :
+	m_available(0),
+	m_head(0),
+	m_tail(0)
+{
+}
+
+void DSPPipeline::Queue::push(Block* block)
+{
+	// never full: there are only NumBlocks blocks plus the NULL sent by stop() after drain()
+	m_ring[m_tail] = block;
+	m_tail = (m_tail + 1) % NumBlocks;
+	m_available.release();
+}
+
+DSPPipeline::Block* DSPPipeline::Queue::pop()
+{
+	m_available.acquire();
+	Block* block = m_ring[m_head];
+	m_head = (m_head + 1) % NumBlocks;
+	return block;
+}
+
+DSPPipeline::Stage::Stage(DSPPipeline* pipeline, StageType type, Queue* input) :
+	m_pipeline(pipeline),
+	m_type(type),
+	m_input(input)
+{
+}
+
+void DSPPipeline::Stage::run()
+{
+	static const char* names[] = { "sdr-correction", "sdr-fanout", "sdr-spectrum" };
+	ThreadPolicy::apply(ThreadPolicy::TcPipeline, names[m_type]);
+
+	Block* block;
+	while((block = m_input->pop()) != NULL)
+		m_pipeline->process(m_type, block);
+}
+
+DSPPipeline::DSPPipeline(DSPEngine* engine) :
+	m_engine(engine),
+	m_freeLock(),
+	m_freeLockMetrics(&m_freeLock),
+	m_free(),
+	m_draining(false),
+	m_drained(0),
+	m_stages()
+{
+	for(int i = 0; i < NumBlocks; i++)
+		m_free.append(&m_blocks[i]);
+	m_freeLockMetrics.setName("pipeline-free");
+}
+
+DSPPipeline::~DSPPipeline()
+{
+	stop();
+}
+
+void DSPPipeline::start()
+{
+	if(isRunning())
+		return;
+
+	m_stages.append(new Stage(this, StCorrection, &m_correctionQueue));
+	m_stages.append(new Stage(this, StFanOut, &m_fanOutQueue));
+	m_stages.append(new Stage(this, StSpectrum, &m_spectrumQueue));
+	for(int i = 0; i < m_stages.count(); i++)
+		m_stages[i]->start();
+	qDebug("DSPPipeline: started");
+}
+
+void DSPPipeline::stop()
+{
+	if(!isRunning())
+		return;
+
+	drain();
+	m_correctionQueue.push(NULL);
+	m_fanOutQueue.push(NULL);
+	m_spectrumQueue.push(NULL);
+	for(int i = 0; i < m_stages.count(); i++) {
+		m_stages[i]->wait();
+		delete m_stages[i];
+	}
+	m_stages.clear();
+	qDebug("DSPPipeline: stopped");
+}
+
+DSPPipeline::Block* DSPPipeline::acquireBlock()
+{
+	SpinlockHolder spinlockHolder(&m_freeLock);
+	if(m_free.isEmpty())
+		return NULL;
+	return m_free.takeFirst();
+}
+
+void DSPPipeline::push(Block* block)
+{
+	m_correctionQueue.push(block);
+}
+
+void DSPPipeline::drain()
+{
+	// only the engine thread pushes blocks, so none come in while it waits here
+	m_freeLock.lock();
+	if(m_free.count() >= NumBlocks) {
+		m_freeLock.unlock();
+		return;
+	}
+	m_draining = true;
+	m_freeLock.unlock();
+	m_drained.acquire();
+}
+
+void DSPPipeline::process(StageType type, Block* block)
+{
+	SampleVector::const_iterator begin = block->m_samples.begin();
+	SampleVector::const_iterator end = begin + block->m_count;
+
+	// the stages pass the block's origin on just like the fifos do
+	Latency::setOrigin(block->m_origin);
+
+	switch(type) {
+		case StCorrection:
+			m_engine->correct(block->m_samples.begin(), block->m_samples.begin() + block->m_count);
+			block->m_refs.storeRelease(2);
+			m_fanOutQueue.push(block);
+			m_spectrumQueue.push(block);
+			break;
+
+		case StFanOut:
+			for(DSPEngine::SampleSinks::const_iterator it = m_engine->m_sampleSinks.begin(); it != m_engine->m_sampleSinks.end(); ++it) {
+				if(*it != m_engine->m_mainSpectrumSink)
+					(*it)->profiledFeed(begin, end, block->m_firstOfBurst);
+			}
+			if(block->m_read != 0)
+				Latency::record(Latency::StEngine, Latency::now() - block->m_read);
+			release(block);
+			break;
+
+		case StSpectrum:
+			if(m_engine->m_mainSpectrumSink != NULL)
+				m_engine->m_mainSpectrumSink->profiledFeed(begin, end, block->m_firstOfBurst);
+			release(block);
+			break;
+	}
+}
+
+void DSPPipeline::release(Block* block)
+{
+	if(!block->m_refs.deref()) {
+		SpinlockHolder spinlockHolder(&m_freeLock);
+		m_free.append(block);
+		if(m_draining && (m_free.count() >= NumBlocks)) {
+			m_draining = false;
+			m_drained.release();
+		}
+	}
+}
@@ -29,7 +29,9 @@ void FFTWEngine::configure(int n, bool inverse)
 	m_currentPlan->out = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * n);
 	QTime t;
 	t.start();
-	m_currentPlan->plan = fftwf_plan_dft_1d(n, m_currentPlan->in, m_currentPlan->out, inverse ? FFTW_BACKWARD : FFTW_FORWARD, FFTW_PATIENT);
+	// planning very large transforms patiently takes minutes - estimate those
+	m_currentPlan->plan = fftwf_plan_dft_1d(n, m_currentPlan->in, m_currentPlan->out, inverse ? FFTW_BACKWARD : FFTW_FORWARD,
+		(n > 65536) ? FFTW_ESTIMATE : FFTW_PATIENT);
 	m_globalPlanMutex.unlock();
 	qDebug("FFT: creating FFTW plan (n=%d,%s) took %dms", n, inverse ? "inverse" : "forward", t.elapsed());
 	m_plans.push_back(m_currentPlan);
@@ -71,3 +71,14 @@ void FFTWindow::apply(const Complex* in, Complex* out)
 	for(size_t i = 0; i < m_window.size(); i++)
 		out[i] = in[i] * m_window[i];
 }
+
+void FFTWindow::apply(const Complex* ring, size_t start, Complex* out)
+{
+	size_t n = m_window.size();
+	size_t i;
+
+	for(i = 0; i < n - start; i++)
+		out[i] = ring[start + i] * m_window[i];
+	for(; i < n; i++)
+		out[i] = ring[i - (n - start)] * m_window[i];
+}
@@ -0,0 +1,67 @@
+#include "dsp/overloadcontroller.h"
+
+OverloadController::OverloadController() :
+	m_level(OlNone),
+	m_overloaded(false),
+	m_relaxed(false)
+{
+}
+
+void OverloadController::reset()
+{
+	m_level.storeRelease(OlNone);
+	m_overloaded = false;
+	m_relaxed = false;
+}
+
+bool OverloadController::update(uint fill, uint size, int load)
+{
+	uint fillPercent = (size > 0) ? ((quint64)fill * 100) / size : 0;
+	bool overloaded = (fillPercent >= OverloadFill) || (load >= OverloadLoad);
+	bool relaxed = (fillPercent < RelaxedFill) && (load < RelaxedLoad);
+
+	if(overloaded != m_overloaded) {
+		m_overloaded = overloaded;
+		if(m_overloaded)
+			m_overloadTimer.start();
+	}
+	if(relaxed != m_relaxed) {
+		m_relaxed = relaxed;
+		if(m_relaxed)
+			m_relaxedTimer.start();
+	}
+
+	int level = m_level.loadAcquire();
+	if(m_overloaded && (level < OlCount - 1) && (m_overloadTimer.elapsed() >= StepUpMs)) {
+		level++;
+		// the next step has to wait for the effect of this one
+		m_overloadTimer.start();
+		qWarning("OverloadController: engine overloaded (fifo %u%%, load %d.%d%%) - %s",
+			fillPercent, load / 10, load % 10, levelName((Level)level));
+	} else if(m_relaxed && (level > OlNone) && (m_relaxedTimer.elapsed() >= StepDownMs)) {
+		level--;
+		m_relaxedTimer.start();
+		qWarning("OverloadController: engine recovered - %s", levelName((Level)level));
+	} else {
+		return false;
+	}
+
+	m_level.storeRelease(level);
+	return true;
+}
+
+const char* OverloadController::levelName(Level level)
+{
+	switch(level) {
+		case OlNone:
+			return "full quality";
+		case OlReduceSpectrum:
+			return "spectrum reduced";
+		case OlPauseScope:
+			return "scope paused";
+		case OlDropSamples:
+			return "dropping samples";
+		default:
+			return "unknown";
+	}
+}
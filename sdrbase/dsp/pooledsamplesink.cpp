@@ -0,0 +1,168 @@
+#include <QThread>
+#include "dsp/pooledsamplesink.h"
+#include "util/message.h"
+
+PooledSampleSink::PooledSampleSink(SinkWorkerPool* pool, SampleSink* sampleSink, bool dropOldest) :
+	m_pool(pool),
+	m_sampleSink(sampleSink),
+	m_feedTimeMetric(Metric::MtCounter, "sdr_sink_feed_microseconds_total", "Time spent in feed() of a sink"),
+	m_samplesMetric(Metric::MtCounter, "sdr_sink_samples_total", "Samples fed to a sink"),
+	m_state(StIdle),
+	m_running(0)
+{
+	setMetricsName(Metrics::instanceName("pooled"));
+
+	// messages are picked up by whatever worker runs the sink next
+	connect(&m_messageQueue, SIGNAL(messageEnqueued()), this, SLOT(handleMessages()), Qt::DirectConnection);
+
+	m_sampleFifo.setSize(128 * 1024);
+	m_sampleFifo.setDropOldest(dropOldest);
+	m_sampleFifo.setLatencyStage(Latency::StSinkFifo);
+}
+
+PooledSampleSink::~PooledSampleSink()
+{
+	// take the sink over for good: either it is idle, or we pull the task out of its queue, or
+	// we wait until the worker which has it is completely done with it
+	for(;;) {
+		int state = m_state.loadAcquire();
+		if(state == StIdle) {
+			if(m_state.testAndSetOrdered(StIdle, StDetached))
+				break;
+		} else if((state == StQueued) && m_pool->cancel(this)) {
+			m_state.storeRelease(StDetached);
+			break;
+		} else {
+			QThread::yieldCurrentThread();
+		}
+	}
+}
+
+void PooledSampleSink::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
+{
+	// the gap is passed on by the reader of the fifo
+	if(firstOfBurst)
+		m_sampleFifo.markGap();
+	m_sampleFifo.write(begin, end);
+	schedule();
+}
+
+void PooledSampleSink::start()
+{
+	QMutexLocker mutexLocker(&m_mutex);
+	if(m_sampleSink != NULL)
+		m_sampleSink->start();
+	m_running.storeRelease(1);
+}
+
+void PooledSampleSink::stop()
+{
+	QMutexLocker mutexLocker(&m_mutex);
+	m_running.storeRelease(0);
+	if(m_sampleSink != NULL)
+		m_sampleSink->stop();
+	m_sampleFifo.readCommit(m_sampleFifo.fill());
+}
+
+bool PooledSampleSink::handleMessage(Message* cmd)
+{
+	// called from other thread
+	m_messageQueue.submit(cmd);
+	return true;
+}
+
+void PooledSampleSink::setMetricsName(const QString& name)
+{
+	QString labels = QString("sink=\"%1\"").arg(name);
+	m_feedTimeMetric.setLabels(labels);
+	m_samplesMetric.setLabels(labels);
+	m_sampleFifo.setMetricsName(name);
+	m_messageQueue.setMetricsName(name);
+	// engine -> fifo here, the work itself in the wrapped sink
+	m_profile.setName(name, "hand-off");
+	if(m_sampleSink != NULL)
+		m_sampleSink->getProfile()->setName(name, "processing");
+}
+
+void PooledSampleSink::run()
+{
+	m_state.storeRelease(StRunning);
+
+	{
+		QMutexLocker mutexLocker(&m_mutex);
+
+		Message* message;
+		while((message = m_messageQueue.accept()) != NULL) {
+			if(m_sampleSink != NULL) {
+				if(!m_sampleSink->handleMessage(message))
+					message->completed();
+			} else {
+				message->completed();
+			}
+		}
+
+		if(m_running.loadAcquire() != 0)
+			handleData();
+	}
+
+	// the sink may be gone as soon as it is idle, so that is the last access
+	if(m_state.testAndSetOrdered(StRunning, StIdle))
+		return;
+	// whatever arrived while we were working goes to the back of the queue. The destructor
+	// cannot cancel the task before it is queued, so the sink is still there for schedule()
+	m_state.storeRelease(StQueued);
+	if(!m_pool->schedule(this))
+		m_state.storeRelease(StIdle);
+}
+
+void PooledSampleSink::schedule()
+{
+	for(;;) {
+		int state = m_state.loadAcquire();
+		if(state == StIdle) {
+			if(m_state.testAndSetOrdered(StIdle, StQueued)) {
+				if(!m_pool->schedule(this))
+					m_state.storeRelease(StIdle);
+				return;
+			}
+		} else if(state == StRunning) {
+			if(m_state.testAndSetOrdered(StRunning, StRerun))
+				return;
+		} else {
+			// already queued, rerun pending or detached
+			return;
+		}
+	}
+}
+
+void PooledSampleSink::handleData()
+{
+	// one pass over what is there now - anything newer gets its turn after the other channels
+	SampleVector::iterator part1begin;
+	SampleVector::iterator part1end;
+	SampleVector::iterator part2begin;
+	SampleVector::iterator part2end;
+
+	size_t count = m_sampleFifo.readBegin(m_sampleFifo.fill(), &part1begin, &part1end, &part2begin, &part2end);
+
+	if(m_sampleSink != NULL) {
+		qint64 startTime = Latency::now();
+		bool firstOfBurst = m_sampleFifo.readAfterGap();
+		if(part1begin != part1end) {
+			m_sampleSink->profiledFeed(part1begin, part1end, firstOfBurst);
+			firstOfBurst = false;
+		}
+		if(part2begin != part2end)
+			m_sampleSink->profiledFeed(part2begin, part2end, firstOfBurst);
+		m_feedTimeMetric.add(Latency::now() - startTime);
+		m_samplesMetric.add(count);
+	}
+
+	m_sampleFifo.readCommit(count);
+}
+
+void PooledSampleSink::handleMessages()
+{
+	// called from the thread that submitted the message
+	schedule();
+}
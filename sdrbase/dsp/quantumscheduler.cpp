@@ -0,0 +1,72 @@
+#include "dsp/quantumscheduler.h"
+
+QuantumScheduler::QuantumScheduler(int quantumUs, int budgetUs) :
+	m_quantumUs(quantumUs),
+	m_budgetUs(budgetUs),
+	m_sampleRate(0),
+	m_quantumSize(DefaultQuantumSize),
+	m_loadAverage(0.0),
+	m_lagUs(0),
+	m_load(0),
+	m_missedDeadlines(0),
+	m_quanta(0)
+{
+	m_burstTimer.start();
+	m_quantumTimer.start();
+}
+
+void QuantumScheduler::setSampleRate(uint sampleRate)
+{
+	m_sampleRate = sampleRate;
+	if(m_sampleRate > 0) {
+		m_quantumSize = ((quint64)m_sampleRate * m_quantumUs) / 1000000;
+		if(m_quantumSize < 256)
+			m_quantumSize = 256;
+	} else {
+		m_quantumSize = DefaultQuantumSize;
+	}
+}
+
+void QuantumScheduler::beginBurst()
+{
+	m_burstTimer.start();
+}
+
+bool QuantumScheduler::budgetExhausted() const
+{
+	return m_burstTimer.nsecsElapsed() / 1000 >= m_budgetUs;
+}
+
+void QuantumScheduler::beginQuantum()
+{
+	m_quantumTimer.start();
+}
+
+void QuantumScheduler::endQuantum(uint count, uint backlog)
+{
+	m_quanta.fetchAndAddRelaxed(1);
+	if((m_sampleRate == 0) || (count == 0))
+		return;
+
+	qint64 elapsedUs = m_quantumTimer.nsecsElapsed() / 1000;
+	qint64 signalUs = ((quint64)count * 1000000) / m_sampleRate;
+
+	// the deadline of a quantum is the time its samples last
+	if(elapsedUs > signalUs)
+		m_missedDeadlines.fetchAndAddRelaxed(1);
+
+	// about one second of history
+	double alpha = (double)signalUs / 1000000.0;
+	if(alpha > 1.0)
+		alpha = 1.0;
+	m_loadAverage += alpha * ((double)elapsedUs / (double)(signalUs > 0 ? signalUs : 1) - m_loadAverage);
+	m_load.storeRelease((int)(m_loadAverage * 1000.0));
+
+	m_lagUs.storeRelease((int)qMin<quint64>(((quint64)backlog * 1000000) / m_sampleRate, 0x7fffffff));
+}
+
+void QuantumScheduler::resetStats()
+{
+	m_missedDeadlines.storeRelease(0);
+	m_quanta.storeRelease(0);
+}
@@ -25,9 +25,19 @@ void SampleFifo::create(uint s)
 	m_fill = 0;
 	m_head = 0;
 	m_tail = 0;
+	m_readPending = 0;
+	m_markerHead = 0;
+	m_markerCount = 0;
+	m_writeCount = 0;
+	m_gapHead = 0;
+	m_gapCount = 0;
+	m_gapAtHead = false;
+	m_readAfterGap = false;
+	m_dropped = 0;
 
 	m_data.resize(s);
 	m_size = m_data.size();
+	m_fillMetric.set(0);
 
 	if(m_size != s)
 		qCritical("SampleFifo: out of memory");
@@ -35,19 +45,40 @@ void SampleFifo::create(uint s)
 
 SampleFifo::SampleFifo(QObject* parent) :
 	QObject(parent),
-	m_data()
+	m_data(),
+	m_dropOldest(false),
+	m_latencyStage(Latency::StSourceFifo),
+	m_fillMetric(Metric::MtGauge, "sdr_sample_fifo_fill", "Samples waiting in a sample FIFO"),
+	m_overflowsMetric(Metric::MtCounter, "sdr_sample_fifo_overflows_total", "Blocks a sample FIFO had no room for"),
+	m_droppedMetric(Metric::MtCounter, "sdr_sample_fifo_dropped_samples_total", "Samples thrown away by a sample FIFO")
 {
+	setMetricsName(Metrics::instanceName("fifo"));
 	m_suppressed = -1;
 	m_size = 0;
 	m_fill = 0;
 	m_head = 0;
 	m_tail = 0;
+	m_readPending = 0;
+	m_markerHead = 0;
+	m_markerCount = 0;
+	m_writeCount = 0;
+	m_gapHead = 0;
+	m_gapCount = 0;
+	m_gapAtHead = false;
+	m_readAfterGap = false;
+	m_dropped = 0;
 }
 
 SampleFifo::SampleFifo(int size, QObject* parent) :
 	QObject(parent),
-	m_data()
+	m_data(),
+	m_dropOldest(false),
+	m_latencyStage(Latency::StSourceFifo),
+	m_fillMetric(Metric::MtGauge, "sdr_sample_fifo_fill", "Samples waiting in a sample FIFO"),
+	m_overflowsMetric(Metric::MtCounter, "sdr_sample_fifo_overflows_total", "Blocks a sample FIFO had no room for"),
+	m_droppedMetric(Metric::MtCounter, "sdr_sample_fifo_dropped_samples_total", "Samples thrown away by a sample FIFO")
 {
+	setMetricsName(Metrics::instanceName("fifo"));
 	m_suppressed = -1;
 
 	create(size);
@@ -60,6 +91,14 @@ SampleFifo::~SampleFifo()
 	m_size = 0;
 }
 
+void SampleFifo::setMetricsName(const QString& name)
+{
+	QString labels = QString("fifo=\"%1\"").arg(name);
+	m_fillMetric.setLabels(labels);
+	m_overflowsMetric.setLabels(labels);
+	m_droppedMetric.setLabels(labels);
+}
+
 bool SampleFifo::setSize(int size)
 {
 	create(size);
@@ -126,8 +165,30 @@ uint SampleFifo::write(SampleVector::const_iterator begin, SampleVector::const_i
 	uint remaining;
 	uint len;
 
-	total = MIN(count, m_size - m_fill);
+	if(m_dropOldest && (count > m_size - m_fill)) {
+		// throw away the unread backlog, but never the part a reader is working on
+		uint dropped = m_fill - m_readPending;
+		m_tail = (m_head + m_readPending) % m_size;
+		m_fill = m_readPending;
+		pushGap(m_writeCount);
+		// keep only the newest samples if the block alone does not fit
+		if(count > m_size - m_fill) {
+			dropped += count - (m_size - m_fill);
+			begin = end - (m_size - m_fill);
+			count = end - begin;
+		}
+		m_dropped += dropped;
+		m_droppedMetric.add(dropped);
+	}
+
+	// a block which does not fit is dropped as a whole, the reader sees a gap in front of the next one
+	total = (count <= m_size - m_fill) ? count : 0;
 	if(total < count) {
+		m_dropped += count;
+		m_overflowsMetric.add();
+		m_droppedMetric.add(count);
+		pushGap(m_writeCount);
+
 		if(m_suppressed < 0) {
 			m_suppressed = 0;
 			m_msgRateTimer.start();
@@ -143,6 +204,10 @@ uint SampleFifo::write(SampleVector::const_iterator begin, SampleVector::const_i
 		}
 	}
 
+	if((total > 0) && Latency::isEnabled())
+		pushMarker(total);
+	m_writeCount += total;
+
 	remaining = total;
 	while(remaining > 0) {
 		len = MIN(remaining, m_size - m_tail);
@@ -153,6 +218,8 @@ uint SampleFifo::write(SampleVector::const_iterator begin, SampleVector::const_i
 		remaining -= len;
 	}
 
+	m_fillMetric.set(m_fill);
+
 	if(m_fill > 0)
 		emit dataReady();
 
@@ -200,6 +267,20 @@ uint SampleFifo::readBegin(uint count,
 	if(total < count)
 		qCritical("SampleFifo: underflow - missing %u samples", count - total);
 
+	// never read across a gap, the data behind it is returned by the next read
+	quint64 readPos = m_writeCount - m_fill;
+	m_readAfterGap = m_gapAtHead;
+	for(uint i = 0; i < m_gapCount; i++) {
+		quint64 gap = m_gaps[(m_gapHead + i) % MaxGaps];
+		if(gap <= readPos) {
+			m_readAfterGap = true;
+		} else {
+			if(gap - readPos < total)
+				total = gap - readPos;
+			break;
+		}
+	}
+
 	remaining = total;
 	if(remaining > 0) {
 		len = MIN(remaining, m_size - head);
@@ -222,9 +303,92 @@ uint SampleFifo::readBegin(uint count,
 		*part2End = m_data.end();
 	}
 
+	m_readPending = done;
+
+	if((done > 0) && Latency::isEnabled()) {
+		// skip the markers of blocks which have been read completely or dropped
+		while((m_markerCount > 0) && (m_markers[m_markerHead].m_end <= readPos))
+			popMarker();
+		const Marker& marker = m_markers[m_markerHead];
+		if((m_markerCount > 0) && (marker.m_begin <= readPos)) {
+			Latency::record(m_latencyStage, Latency::now() - marker.m_written);
+			Latency::setOrigin(marker.m_origin);
+		} else {
+			Latency::setOrigin(0);
+		}
+	}
+
 	return done;
 }
 
+void SampleFifo::pushMarker(uint count)
+{
+	// if all markers are in use the block is accounted to the newest one - this overestimates
+	// the latency instead of hiding it
+	if(m_markerCount >= MaxMarkers) {
+		m_markers[(m_markerHead + m_markerCount - 1) % MaxMarkers].m_end = m_writeCount + count;
+		return;
+	}
+
+	Marker& marker = m_markers[(m_markerHead + m_markerCount) % MaxMarkers];
+	marker.m_begin = m_writeCount;
+	marker.m_end = m_writeCount + count;
+	marker.m_written = Latency::now();
+	// the source callback is where blocks enter the chain, later fifos inherit the writer's origin
+	marker.m_origin = Latency::origin();
+	if(marker.m_origin == 0)
+		marker.m_origin = marker.m_written;
+	m_markerCount++;
+}
+
+void SampleFifo::pushGap(quint64 pos)
+{
+	if((m_gapCount > 0) && (m_gaps[(m_gapHead + m_gapCount - 1) % MaxGaps] == pos))
+		return;
+	// out of slots: the newest gap moves up, the reader still sees a gap - just a little late
+	if(m_gapCount >= MaxGaps) {
+		m_gaps[(m_gapHead + m_gapCount - 1) % MaxGaps] = pos;
+		return;
+	}
+	m_gaps[(m_gapHead + m_gapCount) % MaxGaps] = pos;
+	m_gapCount++;
+}
+
+void SampleFifo::markGap()
+{
+	QMutexLocker mutexLocker(&m_mutex);
+
+	pushGap(m_writeCount);
+}
+
+uint SampleFifo::skip(uint count)
+{
+	QMutexLocker mutexLocker(&m_mutex);
+
+	// only between reads, a reader may still be working on the data at the head
+	if(m_readPending > 0)
+		return 0;
+	if(count > m_fill)
+		count = m_fill;
+	if(count == 0)
+		return 0;
+
+	m_head = (m_head + count) % m_size;
+	m_fill -= count;
+	m_dropped += count;
+	m_droppedMetric.add(count);
+	m_fillMetric.set(m_fill);
+	m_gapAtHead = true;
+
+	return count;
+}
+
+void SampleFifo::popMarker()
+{
+	m_markerHead = (m_markerHead + 1) % MaxMarkers;
+	m_markerCount--;
+}
+
 uint SampleFifo::readCommit(uint count)
 {
 	QMutexLocker mutexLocker(&m_mutex);
@@ -233,8 +397,20 @@ uint SampleFifo::readCommit(uint count)
 		qCritical("SampleFifo: cannot commit more than available samples");
 		count = m_fill;
 	}
+	quint64 readPos = m_writeCount - m_fill;
 	m_head = (m_head + count) % m_size;
 	m_fill -= count;
+	m_readPending = (count < m_readPending) ? m_readPending - count : 0;
+	m_fillMetric.set(m_fill);
+
+	// the gaps in front of what has been read are done with
+	if(count > 0) {
+		m_gapAtHead = false;
+		while((m_gapCount > 0) && (m_gaps[m_gapHead] <= readPos)) {
+			m_gapHead = (m_gapHead + 1) % MaxGaps;
+			m_gapCount--;
+		}
+	}
 
 	return count;
 }
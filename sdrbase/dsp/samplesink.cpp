@@ -1,6 +1,7 @@
 #include "dsp/samplesink.h"
 
-SampleSink::SampleSink()
+SampleSink::SampleSink() :
+	m_profile()
 {
 }
 
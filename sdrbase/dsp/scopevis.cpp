@@ -1,115 +1,93 @@
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+#include <math.h>
 #include "dsp/scopevis.h"
 #include "gui/glscope.h"
 #include "dsp/dspcommands.h"
+#include "dsp/overloadcontroller.h"
 #include "util/messagequeue.h"
 
 ScopeVis::ScopeVis(GLScope* glScope) :
 	m_glScope(glScope),
 	m_trace(100000),
+	m_traceSize(100000),
 	m_fill(0),
-	m_triggerState(Untriggered),
+	m_triggerState(Triggered),
 	m_triggerChannel(TriggerFreeRun),
 	m_triggerLevelHigh(0.01 * 32768),
 	m_triggerLevelLow(0.01 * 32768 - 1024),
-	m_sampleRate(0)
+	m_triggerCosHigh(0.0),
+	m_triggerCosLow(1.0),
+	m_lastSample(0, 0),
+	m_sampleRate(0),
+	m_paused(false),
+	m_preTrigger(),
+	m_preTriggerPos(0),
+	m_preTriggerFill(0)
 {
 }
 
-void ScopeVis::configure(MessageQueue* msgQueue, TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow)
+void ScopeVis::configure(MessageQueue* msgQueue, TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow,
+	int traceSize, int triggerPre)
 {
-	Message* cmd = DSPConfigureScopeVis::create(triggerChannel, triggerLevelHigh, triggerLevelLow);
+	Message* cmd = DSPConfigureScopeVis::create(triggerChannel, triggerLevelHigh, triggerLevelLow, traceSize, triggerPre);
 	cmd->submit(msgQueue, this);
 }
 
 void ScopeVis::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
+	if(m_paused)
+		return;
+	// a trace never spans a gap in the samples
+	if(firstOfBurst)
+		restartCapture();
+
+	SampleVector::const_iterator first = begin;
+
 	while(begin < end) {
-		if(m_triggerChannel == TriggerChannelI) {
-			if(m_triggerState == Untriggered) {
-				while(begin < end) {
-					if(begin->real() >= m_triggerLevelHigh) {
-						m_triggerState = Triggered;
-						break;
-					}
-					++begin;
-				}
-			}
-			if(m_triggerState == Triggered) {
-				int count = end - begin;
-				if(count > (int)(m_trace.size() - m_fill))
-					count = m_trace.size() - m_fill;
-				std::vector<Complex>::iterator it = m_trace.begin() + m_fill;
-				for(int i = 0; i < count; ++i) {
-					*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
-					++begin;
-				}
-				m_fill += count;
-				if(m_fill >= m_trace.size()) {
-					m_glScope->newTrace(m_trace, m_sampleRate);
-					m_fill = 0;
-					m_triggerState = WaitForReset;
-				}
-			}
-			if(m_triggerState == WaitForReset) {
-				while(begin < end) {
-					if(begin->real() < m_triggerLevelLow) {
-						m_triggerState = Untriggered;
-						break;
-					}
-					++begin;
-				}
-			}
-		} else if(m_triggerChannel == TriggerChannelQ) {
-			if(m_triggerState == Untriggered) {
-				while(begin < end) {
-					if(begin->imag() >= m_triggerLevelHigh) {
-						m_triggerState = Triggered;
-						break;
-					}
-					++begin;
-				}
-			}
-			if(m_triggerState == Triggered) {
-				int count = end - begin;
-				if(count > (int)(m_trace.size() - m_fill))
-					count = m_trace.size() - m_fill;
-				std::vector<Complex>::iterator it = m_trace.begin() + m_fill;
-				for(int i = 0; i < count; ++i) {
-					*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
-					++begin;
-				}
-				m_fill += count;
-				if(m_fill >= m_trace.size()) {
-					m_glScope->newTrace(m_trace, m_sampleRate);
-					m_fill = 0;
-					m_triggerState = WaitForReset;
-				}
-			}
-			if(m_triggerState == WaitForReset) {
-				while(begin < end) {
-					if(begin->imag() < m_triggerLevelLow) {
-						m_triggerState = Untriggered;
-						break;
-					}
-					++begin;
-				}
-			}
-		} else {
-			int count = end - begin;
-			if(count > (int)(m_trace.size() - m_fill))
-				count = m_trace.size() - m_fill;
+		if(begin > first)
+			m_lastSample = *(begin - 1);
+		int count = end - begin;
+
+		if(m_triggerState == Triggered) {
+			if(count > (int)(m_traceSize - m_fill))
+				count = m_traceSize - m_fill;
 			std::vector<Complex>::iterator it = m_trace.begin() + m_fill;
 			for(int i = 0; i < count; ++i) {
 				*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
 				++begin;
 			}
 			m_fill += count;
-			if(m_fill >= m_trace.size()) {
+			if(m_fill >= m_traceSize) {
 				m_glScope->newTrace(m_trace, m_sampleRate);
+				m_trace.resize(m_traceSize); // the scope hands back its previous buffer
 				m_fill = 0;
+				if(m_triggerChannel != TriggerFreeRun) {
+					m_triggerState = WaitForReset;
+					m_preTriggerFill = 0;
+				}
+			}
+		} else if(m_preTriggerFill < m_preTrigger.size()) {
+			// not enough history for the pre-trigger part of the trace yet
+			if(count > (int)(m_preTrigger.size() - m_preTriggerFill))
+				count = m_preTrigger.size() - m_preTriggerFill;
+			storePreTrigger(begin, count);
+			begin += count;
+		} else {
+			int n = findLevel(begin, count, m_triggerState == Untriggered);
+			storePreTrigger(begin, n);
+			begin += n;
+			if(n < count) {
+				if(m_triggerState == Untriggered)
+					startTrace();
+				else m_triggerState = Untriggered;
 			}
 		}
 	}
+
+	if(end > first)
+		m_lastSample = *(end - 1);
 }
 
 void ScopeVis::start()
@@ -129,13 +107,177 @@ bool ScopeVis::handleMessage(Message* message)
 		return true;
 	} else if(DSPConfigureScopeVis::match(message)) {
 		DSPConfigureScopeVis* conf = (DSPConfigureScopeVis*)message;
-		m_triggerState = Untriggered;
 		m_triggerChannel = (TriggerChannel)conf->getTriggerChannel();
-		m_triggerLevelHigh = conf->getTriggerLevelHigh() * 32767;
-		m_triggerLevelLow = conf->getTriggerLevelLow() * 32767;
+
+		Real high = conf->getTriggerLevelHigh();
+		Real low = conf->getTriggerLevelLow();
+		if(m_triggerChannel == TriggerMagnitude) {
+			m_triggerLevelHigh = high > 0 ? (high * 32767) * (high * 32767) : 0;
+			m_triggerLevelLow = low > 0 ? (low * 32767) * (low * 32767) : 0;
+		} else if(m_triggerChannel == TriggerPhaseStep) {
+			m_triggerCosHigh = cos(high * M_PI);
+			m_triggerCosLow = cos(low * M_PI);
+		} else {
+			m_triggerLevelHigh = high * 32767;
+			m_triggerLevelLow = low * 32767;
+		}
+
+		m_traceSize = conf->getTraceSize();
+		if(m_traceSize < 1000)
+			m_traceSize = 1000;
+		else if(m_traceSize > (1 << 20))
+			m_traceSize = 1 << 20;
+		m_trace.resize(m_traceSize);
+
+		uint preSize = 0;
+		if(m_triggerChannel != TriggerFreeRun) {
+			int pre = conf->getTriggerPre();
+			if(pre > 0)
+				preSize = ((qint64)m_traceSize * (pre < 100 ? pre : 99)) / 100;
+		}
+		m_preTrigger.resize(preSize);
+		m_preTriggerPos = 0;
+		restartCapture();
+		message->completed();
+		return true;
+	} else if(DSPOverloadNotification::match(message)) {
+		bool paused = DSPOverloadNotification::cast(message)->getLevel() >= OverloadController::OlPauseScope;
+		if(paused != m_paused) {
+			m_paused = paused;
+			qDebug("ScopeVis: capture %s", m_paused ? "paused" : "resumed");
+			restartCapture();
+		}
 		message->completed();
 		return true;
 	} else {
 		return false;
 	}
 }
+
+// returns the offset of the first sample at or above the high level (high = true)
+// or below the low level (high = false), count if there is none
+int ScopeVis::findLevel(SampleVector::const_iterator begin, int count, bool high)
+{
+	if(m_triggerChannel == TriggerPhaseStep)
+		return findPhaseStep(begin, count, high);
+
+	const Sample* s = &(*begin);
+	qint32 level = high ? m_triggerLevelHigh : m_triggerLevelLow;
+	int i = 0;
+
+#ifdef USE_SIMD
+	// four samples per register, a lane mask selects the bytes belonging to the compared value
+	__m128i levelv;
+	int laneMask;
+	if(m_triggerChannel == TriggerMagnitude) {
+		levelv = _mm_set1_epi32(level ^ 0x80000000);
+		laneMask = 0xffff;
+	} else {
+		levelv = _mm_set1_epi16(level);
+		laneMask = (m_triggerChannel == TriggerChannelI) ? 0x3333 : 0xcccc;
+	}
+	int invert = high ? 0xffff : 0x0000;
+
+	for(; i + 4 <= count; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+		__m128i below;
+		if(m_triggerChannel == TriggerMagnitude) {
+			// (-32768)^2 * 2 does not fit a signed int - compare unsigned by flipping the sign bits
+			v = _mm_xor_si128(_mm_madd_epi16(v, v), _mm_set1_epi32(0x80000000));
+			below = _mm_cmpgt_epi32(levelv, v);
+		} else {
+			below = _mm_cmpgt_epi16(levelv, v);
+		}
+		int mask = (_mm_movemask_epi8(below) ^ invert) & laneMask;
+		if(mask != 0) {
+			for(int j = 0; j < 4; j++) {
+				if(mask & (0x0f << (j * 4)))
+					return i + j;
+			}
+		}
+	}
+#endif
+
+	for(; i < count; i++) {
+		bool above;
+		if(m_triggerChannel == TriggerMagnitude)
+			above = (quint32)(s[i].m_real * s[i].m_real) + (quint32)(s[i].m_imag * s[i].m_imag) >= (quint32)level;
+		else if(m_triggerChannel == TriggerChannelI)
+			above = s[i].m_real >= level;
+		else above = s[i].m_imag >= level;
+		if(above == high)
+			return i;
+	}
+
+	return count;
+}
+
+// |arg(s[n] * conj(s[n - 1]))| >= acos(c) is the same as dot <= c * |s[n]| * |s[n - 1]|,
+// which can be decided on the squares without sqrt or atan2
+int ScopeVis::findPhaseStep(SampleVector::const_iterator begin, int count, bool high)
+{
+	Real c = high ? m_triggerCosHigh : m_triggerCosLow;
+	Real c2 = c * c;
+	Sample last = m_lastSample;
+
+	for(int i = 0; i < count; i++) {
+		const Sample& s = *(begin + i);
+		Real dot = (Real)s.m_real * last.m_real + (Real)s.m_imag * last.m_imag;
+		Real p = ((Real)s.m_real * s.m_real + (Real)s.m_imag * s.m_imag) * ((Real)last.m_real * last.m_real + (Real)last.m_imag * last.m_imag);
+		bool step;
+		if(p <= 0)
+			step = false;
+		else if(c >= 0)
+			step = (dot <= 0) || (dot * dot <= c2 * p);
+		else step = (dot < 0) && (dot * dot >= c2 * p);
+		if(step == high)
+			return i;
+		last = s;
+	}
+
+	return count;
+}
+
+void ScopeVis::storePreTrigger(SampleVector::const_iterator begin, int count)
+{
+	uint size = m_preTrigger.size();
+	if(size == 0)
+		return;
+
+	if(count > (int)size) {
+		begin += count - size;
+		count = size;
+	}
+	while(count > 0) {
+		int n = size - m_preTriggerPos;
+		if(n > count)
+			n = count;
+		std::copy(begin, begin + n, m_preTrigger.begin() + m_preTriggerPos);
+		m_preTriggerPos = (m_preTriggerPos + n) % size;
+		m_preTriggerFill += n;
+		begin += n;
+		count -= n;
+	}
+	if(m_preTriggerFill > size)
+		m_preTriggerFill = size;
+}
+
+void ScopeVis::startTrace()
+{
+	// the history ring is full at this point, its oldest sample sits at m_preTriggerPos
+	uint size = m_preTrigger.size();
+	std::vector<Complex>::iterator it = m_trace.begin();
+	for(uint i = 0; i < size; i++) {
+		const Sample& s = m_preTrigger[(m_preTriggerPos + i) % size];
+		*it++ = Complex(s.real() / 32768.0, s.imag() / 32768.0);
+	}
+	m_fill = size;
+	m_triggerState = Triggered;
+}
+
+void ScopeVis::restartCapture()
+{
+	m_fill = 0;
+	m_preTriggerFill = 0;
+	m_triggerState = (m_triggerChannel == TriggerFreeRun) ? Triggered : Untriggered;
+}
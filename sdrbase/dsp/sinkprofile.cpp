@@ -0,0 +1,118 @@
+#include <QMutex>
+#include <QMap>
+#include <QElapsedTimer>
+#include "dsp/sinkprofile.h"
+
+namespace {
+	struct ProfileClock {
+		QElapsedTimer m_timer;
+		ProfileClock() { m_timer.start(); }
+	};
+	ProfileClock profileClock;
+
+	// only locked when a profile is named or destroyed and by collect()
+	QMutex registryMutex;
+	QList<SinkProfile*> registry;
+}
+
+QAtomicInt SinkProfile::m_enabled(0);
+
+SinkProfile::SinkProfile() :
+	m_name(),
+	m_stage(),
+	m_registered(false),
+	m_lock(),
+	m_lockMetrics(NULL),
+	m_calls(0),
+	m_samplesIn(0),
+	m_samplesOut(0),
+	m_totalNs(0),
+	m_maxNs(0)
+{
+}
+
+SinkProfile::~SinkProfile()
+{
+	if(m_registered) {
+		QMutexLocker mutexLocker(&registryMutex);
+		registry.removeAll(this);
+	}
+	delete m_lockMetrics;
+}
+
+void SinkProfile::setEnabled(bool enabled)
+{
+	m_enabled.storeRelease(enabled ? 1 : 0);
+}
+
+qint64 SinkProfile::now()
+{
+	// never 0, that means "not measured" to end()
+	return profileClock.m_timer.nsecsElapsed() + 1;
+}
+
+void SinkProfile::setName(const QString& name, const QString& stage)
+{
+	QMutexLocker mutexLocker(&registryMutex);
+	m_name = name;
+	m_stage = stage;
+	if(!m_registered) {
+		registry.append(this);
+		m_registered = true;
+	}
+	if(m_lockMetrics == NULL)
+		m_lockMetrics = new SpinlockMetrics(&m_lock);
+	m_lockMetrics->setName(QString("profile:%1/%2").arg(name).arg(stage));
+}
+
+void SinkProfile::end(qint64 start, qint64 samples)
+{
+	if(start == 0)
+		return;
+	qint64 ns = now() - start;
+
+	SpinlockHolder spinlockHolder(&m_lock);
+	m_calls++;
+	m_samplesIn += samples;
+	m_totalNs += ns;
+	if(ns > m_maxNs)
+		m_maxNs = ns;
+}
+
+SinkProfile::Snapshots SinkProfile::collect()
+{
+	QMap<QString, Snapshot> sorted;
+	QMutexLocker mutexLocker(&registryMutex);
+
+	for(int i = 0; i < registry.count(); i++) {
+		SinkProfile* profile = registry[i];
+		Snapshot snapshot;
+		snapshot.m_name = profile->m_name;
+		snapshot.m_stage = profile->m_stage;
+		{
+			SpinlockHolder spinlockHolder(&profile->m_lock);
+			snapshot.m_calls = profile->m_calls;
+			snapshot.m_samplesIn = profile->m_samplesIn;
+			snapshot.m_samplesOut = profile->m_samplesOut;
+			snapshot.m_totalNs = profile->m_totalNs;
+			snapshot.m_maxNs = profile->m_maxNs;
+		}
+		sorted.insertMulti(snapshot.m_name + "/" + snapshot.m_stage, snapshot);
+	}
+
+	return sorted.values();
+}
+
+void SinkProfile::resetAll()
+{
+	QMutexLocker mutexLocker(&registryMutex);
+	for(int i = 0; i < registry.count(); i++) {
+		SinkProfile* profile = registry[i];
+		SpinlockHolder spinlockHolder(&profile->m_lock);
+		profile->m_calls = 0;
+		profile->m_samplesIn = 0;
+		profile->m_samplesOut = 0;
+		profile->m_totalNs = 0;
+		profile->m_maxNs = 0;
+	}
+}
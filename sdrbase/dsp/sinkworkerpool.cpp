@@ -0,0 +1,164 @@
+#include "dsp/sinkworkerpool.h"
+#include "util/threadpolicy.h"
+
+SinkWorkerPool::Worker::Worker(SinkWorkerPool* pool, int index) :
+	m_pool(pool),
+	m_index(index)
+{
+}
+
+void SinkWorkerPool::Worker::run()
+{
+	ThreadPolicy::apply(ThreadPolicy::TcSink, qPrintable(QString("sdr-worker-%1").arg(m_index)));
+
+	while(m_pool->m_stopping.loadAcquire() == 0) {
+		Task* task = m_pool->takeTask(m_index);
+		if(task == NULL) {
+			m_pool->waitForTask();
+			continue;
+		}
+		task->m_lastWorker = m_index;
+		task->run();
+		m_pool->m_tasksRun.fetchAndAddRelaxed(1);
+	}
+}
+
+SinkWorkerPool::SinkWorkerPool() :
+	m_workers(),
+	m_queues(),
+	m_stopping(0),
+	m_pending(0),
+	m_idle(0),
+	m_nextQueue(0),
+	m_tasksRun(0),
+	m_steals(0)
+{
+}
+
+SinkWorkerPool::~SinkWorkerPool()
+{
+	stop();
+	for(int i = 0; i < m_queues.count(); i++)
+		delete m_queues[i];
+}
+
+void SinkWorkerPool::start(int numThreads)
+{
+	if(!m_workers.isEmpty())
+		return;
+
+	if(numThreads <= 0)
+		numThreads = QThread::idealThreadCount();
+	if(numThreads <= 0)
+		numThreads = 1;
+
+	// queues survive a stop() so tasks still queued then are picked up after the next start()
+	while(m_queues.count() < numThreads)
+		m_queues.append(new Queue);
+
+	m_stopping.storeRelease(0);
+	for(int i = 0; i < numThreads; i++) {
+		Worker* worker = new Worker(this, i);
+		m_workers.append(worker);
+		worker->start();
+	}
+	qDebug("SinkWorkerPool: started %d workers", numThreads);
+}
+
+void SinkWorkerPool::stop()
+{
+	if(m_workers.isEmpty())
+		return;
+
+	m_stopping.storeRelease(1);
+	m_idleMutex.lock();
+	m_idleCondition.wakeAll();
+	m_idleMutex.unlock();
+
+	for(int i = 0; i < m_workers.count(); i++) {
+		m_workers[i]->wait();
+		delete m_workers[i];
+	}
+	m_workers.clear();
+}
+
+bool SinkWorkerPool::schedule(Task* task)
+{
+	if(m_queues.isEmpty())
+		return false;
+
+	int index = task->m_lastWorker;
+	if((index < 0) || (index >= m_queues.count()))
+		index = (m_nextQueue.fetchAndAddRelaxed(1) & 0x7fffffff) % m_queues.count();
+
+	Queue* queue = m_queues[index];
+	queue->m_mutex.lock();
+	queue->m_tasks.append(task);
+	queue->m_mutex.unlock();
+
+	// pairs with waitForTask(): either the sleeper sees the new task or we see the sleeper
+	m_pending.fetchAndAddOrdered(1);
+	if(m_idle.loadAcquire() > 0) {
+		m_idleMutex.lock();
+		m_idleCondition.wakeOne();
+		m_idleMutex.unlock();
+	}
+	return true;
+}
+
+bool SinkWorkerPool::cancel(Task* task)
+{
+	for(int i = 0; i < m_queues.count(); i++) {
+		Queue* queue = m_queues[i];
+		QMutexLocker mutexLocker(&queue->m_mutex);
+		int pos = queue->m_tasks.indexOf(task);
+		if(pos >= 0) {
+			queue->m_tasks.removeAt(pos);
+			m_pending.fetchAndAddOrdered(-1);
+			return true;
+		}
+	}
+	return false;
+}
+
+SinkWorkerPool::Task* SinkWorkerPool::takeTask(int index)
+{
+	if(m_pending.loadAcquire() <= 0)
+		return NULL;
+
+	// own queue first, oldest task first
+	Queue* queue = m_queues[index];
+	queue->m_mutex.lock();
+	if(!queue->m_tasks.isEmpty()) {
+		Task* task = queue->m_tasks.takeFirst();
+		queue->m_mutex.unlock();
+		m_pending.fetchAndAddOrdered(-1);
+		return task;
+	}
+	queue->m_mutex.unlock();
+
+	// steal from the other end so the owner keeps the tasks it is about to run
+	for(int i = 1; i < m_queues.count(); i++) {
+		queue = m_queues[(index + i) % m_queues.count()];
+		queue->m_mutex.lock();
+		if(!queue->m_tasks.isEmpty()) {
+			Task* task = queue->m_tasks.takeLast();
+			queue->m_mutex.unlock();
+			m_pending.fetchAndAddOrdered(-1);
+			m_steals.fetchAndAddRelaxed(1);
+			return task;
+		}
+		queue->m_mutex.unlock();
+	}
+	return NULL;
+}
+
+void SinkWorkerPool::waitForTask()
+{
+	m_idleMutex.lock();
+	m_idle.fetchAndAddOrdered(1);
+	if((m_pending.loadAcquire() <= 0) && (m_stopping.loadAcquire() == 0))
+		m_idleCondition.wait(&m_idleMutex);
+	m_idle.fetchAndAddOrdered(-1);
+	m_idleMutex.unlock();
+}
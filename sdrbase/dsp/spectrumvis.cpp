@@ -1,9 +1,15 @@
+#include <algorithm>
 #include "dsp/spectrumvis.h"
 #include "gui/glspectrum.h"
 #include "dsp/dspcommands.h"
+#include "dsp/overloadcontroller.h"
 #include "util/messagequeue.h"
+#include "util/trace.h"
 
-#define MAX_FFT_SIZE 8192
+#define MAX_FFT_SIZE (1 << 20)
+#define MAX_DISPLAY_SIZE 8192
+// frame rate while the engine sheds load and no frame rate is configured
+#define SHEDDING_FRAME_RATE 10
 
 #ifdef _WIN32
 double log2f(double n)
@@ -15,12 +21,16 @@ double log2f(double n)
 SpectrumVis::SpectrumVis(GLSpectrum* glSpectrum) :
 	SampleSink(),
 	m_fft(FFTEngine::create()),
-	m_fftBuffer(MAX_FFT_SIZE),
-	m_logPowerSpectrum(MAX_FFT_SIZE),
+	m_fftBuffer(),
+	m_powerSpectrum(),
+	m_logPowerSpectrum(),
+	m_fftSize(0),
 	m_fftBufferFill(0),
+	m_fftBufferPos(0),
+	m_shedding(false),
 	m_glSpectrum(glSpectrum)
 {
-	handleConfigure(1024, 10, FFTWindow::BlackmanHarris);
+	handleConfigure(1024, 10, FFTWindow::BlackmanHarris, AvgNone, 0);
 }
 
 SpectrumVis::~SpectrumVis()
@@ -28,9 +38,10 @@ SpectrumVis::~SpectrumVis()
 	delete m_fft;
 }
 
-void SpectrumVis::configure(MessageQueue* msgQueue, int fftSize, int overlapPercent, FFTWindow::Function window)
+void SpectrumVis::configure(MessageQueue* msgQueue, int fftSize, int overlapPercent, FFTWindow::Function window,
+	AveragingMode averagingMode, int frameRate)
 {
-	Message* cmd = DSPConfigureSpectrumVis::create(fftSize, overlapPercent, window);
+	Message* cmd = DSPConfigureSpectrumVis::create(fftSize, overlapPercent, window, averagingMode, frameRate);
 	cmd->submit(msgQueue, this);
 }
 
@@ -39,51 +50,181 @@ void SpectrumVis::feed(SampleVector::const_iterator begin, SampleVector::const_i
 	// if no visualisation is set, send the samples to /dev/null
 	if(m_glSpectrum == NULL)
 		return;
+	// an FFT never spans a gap in the samples
+	if(firstOfBurst)
+		m_fftBufferFill = 0;
 
 	while(begin < end) {
 		size_t todo = end - begin;
-		size_t samplesNeeded = m_refillSize - m_fftBufferFill;
+		size_t samplesNeeded = m_fftSize - m_fftBufferFill;
 
 		if(todo >= samplesNeeded) {
-			// fill up the buffer
-			std::vector<Complex>::iterator it = m_fftBuffer.begin() + m_fftBufferFill;
-			for(size_t i = 0; i < samplesNeeded; ++i, ++begin)
-				*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
+			// fill up the ring buffer
+			write(begin, samplesNeeded);
+			begin += samplesNeeded;
 
-			// apply fft window (and copy from m_fftBuffer to m_fftIn)
-			m_window.apply(&m_fftBuffer[0], m_fft->in());
+			// when shedding load, frames which would be replaced before they are shown are not computed
+			if(m_shedding && (m_averagingMode == AvgNone) && (m_frameTimer.elapsed() < m_nextFrame)) {
+				m_fftBufferFill = m_overlapSize;
+				continue;
+			}
+
+			TRACE_BEGIN("SpectrumVis fft");
+			// apply fft window starting at the oldest sample (and copy from m_fftBuffer to m_fftIn)
+			m_window.apply(&m_fftBuffer[0], m_fftBufferPos, m_fft->in());
 
 			// calculate FFT
 			m_fft->transform();
 
-			// extract power spectrum and reorder buckets
-			Real ofs = 20.0f * log10f(1.0f / m_fftSize);
-			Real mult = (10.0f / log2f(10.0f));
-			const Complex* fftOut = m_fft->out();
-			for(size_t i = 0; i < m_fftSize; i++) {
-				Complex c = fftOut[((i + (m_fftSize >> 1)) & (m_fftSize - 1))];
-				Real v = c.real() * c.real() + c.imag() * c.imag();
-				v = mult * log2f(v) + ofs;
-				m_logPowerSpectrum[i] = v;
-			}
-
-			// send new data to visualisation
-			m_glSpectrum->newSpectrum(m_logPowerSpectrum, m_fftSize);
+			// extract power spectrum, reorder buckets and fold it into the running average
+			accumulate(m_fft->out());
+			TRACE_END("SpectrumVis fft");
 
-			// advance buffer respecting the fft overlap factor
-			std::copy(m_fftBuffer.begin() + m_refillSize, m_fftBuffer.end(), m_fftBuffer.begin());
+			// send new data to visualisation if the frame rate allows for it
+			if(m_frameInterval <= 0) {
+				output();
+			} else {
+				qint64 now = m_frameTimer.elapsed();
+				if(now >= m_nextFrame) {
+					output();
+					m_nextFrame += m_frameInterval;
+					if(m_nextFrame <= now)
+						m_nextFrame = now + m_frameInterval;
+				}
+			}
 
-			// start over
+			// start over - the overlap region simply stays in the ring buffer
 			m_fftBufferFill = m_overlapSize;
 		} else {
 			// not enough samples for FFT - just fill in new data and return
-			for(std::vector<Complex>::iterator it = m_fftBuffer.begin() + m_fftBufferFill; begin < end; ++begin)
-				*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
+			write(begin, todo);
+			begin = end;
 			m_fftBufferFill += todo;
 		}
 	}
 }
 
+void SpectrumVis::write(SampleVector::const_iterator begin, size_t count)
+{
+	while(count > 0) {
+		size_t len = std::min(count, m_fftSize - m_fftBufferPos);
+		std::vector<Complex>::iterator it = m_fftBuffer.begin() + m_fftBufferPos;
+		for(size_t i = 0; i < len; ++i, ++begin)
+			*it++ = Complex(begin->real() / 32768.0, begin->imag() / 32768.0);
+		m_fftBufferPos = (m_fftBufferPos + len) & (m_fftSize - 1);
+		count -= len;
+	}
+}
+
+void SpectrumVis::accumulate(const Complex* fftOut)
+{
+	size_t half = m_fftSize >> 1;
+	size_t mask = m_fftSize - 1;
+
+	if((m_averagingCount == 0) || (m_averagingMode == AvgNone)) {
+		for(size_t i = 0; i < m_fftSize; i++) {
+			Complex c = fftOut[(i + half) & mask];
+			m_powerSpectrum[i] = c.real() * c.real() + c.imag() * c.imag();
+		}
+		m_averagingCount = 1;
+		return;
+	}
+
+	switch(m_averagingMode) {
+		case AvgLinear:
+			for(size_t i = 0; i < m_fftSize; i++) {
+				Complex c = fftOut[(i + half) & mask];
+				m_powerSpectrum[i] += c.real() * c.real() + c.imag() * c.imag();
+			}
+			break;
+
+		case AvgPeakHold:
+			for(size_t i = 0; i < m_fftSize; i++) {
+				Complex c = fftOut[(i + half) & mask];
+				Real v = c.real() * c.real() + c.imag() * c.imag();
+				if(v > m_powerSpectrum[i])
+					m_powerSpectrum[i] = v;
+			}
+			break;
+
+		case AvgMinHold:
+			for(size_t i = 0; i < m_fftSize; i++) {
+				Complex c = fftOut[(i + half) & mask];
+				Real v = c.real() * c.real() + c.imag() * c.imag();
+				if(v < m_powerSpectrum[i])
+					m_powerSpectrum[i] = v;
+			}
+			break;
+
+		default:
+			break;
+	}
+	m_averagingCount++;
+}
+
+void SpectrumVis::output()
+{
+	// decimate to the smallest power of two that still covers every pixel of the display
+	size_t outSize = m_fftSize;
+	size_t displayWidth = std::max(m_glSpectrum->getDisplayWidth(), 0);
+	while(outSize > MAX_DISPLAY_SIZE)
+		outSize >>= 1;
+	while((outSize > 64) && ((outSize >> 1) >= displayWidth) && (displayWidth > 0))
+		outSize >>= 1;
+	size_t factor = m_fftSize / outSize;
+
+	// the logarithm is only taken once per displayed bin
+	Real ofs = 20.0f * log10f(1.0f / m_fftSize);
+	Real mult = (10.0f / log2f(10.0f));
+	if((m_averagingMode == AvgLinear) && (m_averagingCount > 1))
+		ofs -= mult * log2f(m_averagingCount);
+
+	if(factor == 1) {
+		for(size_t i = 0; i < m_fftSize; i++)
+			m_logPowerSpectrum[i] = mult * log2f(m_powerSpectrum[i]) + ofs;
+	} else {
+		// reduce each group of bins the same way the frames were reduced over time, but keep
+		// narrow carriers visible when not averaging
+		const Real* p = &m_powerSpectrum[0];
+		switch(m_averagingMode) {
+			case AvgLinear:
+				ofs -= mult * log2f(factor);
+				for(size_t i = 0; i < outSize; i++) {
+					Real v = 0;
+					for(size_t j = 0; j < factor; j++)
+						v += *p++;
+					m_logPowerSpectrum[i] = mult * log2f(v) + ofs;
+				}
+				break;
+
+			case AvgMinHold:
+				for(size_t i = 0; i < outSize; i++) {
+					Real v = *p++;
+					for(size_t j = 1; j < factor; j++, p++) {
+						if(*p < v)
+							v = *p;
+					}
+					m_logPowerSpectrum[i] = mult * log2f(v) + ofs;
+				}
+				break;
+
+			default:
+				for(size_t i = 0; i < outSize; i++) {
+					Real v = *p++;
+					for(size_t j = 1; j < factor; j++, p++) {
+						if(*p > v)
+							v = *p;
+					}
+					m_logPowerSpectrum[i] = mult * log2f(v) + ofs;
+				}
+				break;
+		}
+	}
+
+	m_glSpectrum->newSpectrum(m_logPowerSpectrum, outSize);
+	m_averagingCount = 0;
+}
+
 void SpectrumVis::start()
 {
 }
@@ -96,7 +237,17 @@ bool SpectrumVis::handleMessage(Message* message)
 {
 	if(DSPConfigureSpectrumVis::match(message)) {
 		DSPConfigureSpectrumVis* conf = (DSPConfigureSpectrumVis*)message;
-		handleConfigure(conf->getFFTSize(), conf->getOverlapPercent(), conf->getWindow());
+		handleConfigure(conf->getFFTSize(), conf->getOverlapPercent(), conf->getWindow(),
+			(AveragingMode)conf->getAveragingMode(), conf->getFrameRate());
+		message->completed();
+		return true;
+	} else if(DSPOverloadNotification::match(message)) {
+		bool shedding = DSPOverloadNotification::cast(message)->getLevel() >= OverloadController::OlReduceSpectrum;
+		if(shedding != m_shedding) {
+			m_shedding = shedding;
+			qDebug("SpectrumVis: %s frame rate and overlap", m_shedding ? "reduced" : "restored");
+			applyRates();
+		}
 		message->completed();
 		return true;
 	} else {
@@ -104,22 +255,48 @@ bool SpectrumVis::handleMessage(Message* message)
 	}
 }
 
-void SpectrumVis::handleConfigure(int fftSize, int overlapPercent, FFTWindow::Function window)
+void SpectrumVis::handleConfigure(int fftSize, int overlapPercent, FFTWindow::Function window, AveragingMode averagingMode, int frameRate)
 {
 	if(fftSize > MAX_FFT_SIZE)
 		fftSize = MAX_FFT_SIZE;
 	else if(fftSize < 64)
 		fftSize = 64;
-	if(overlapPercent > 100)
-		m_overlapPercent = 100;
+	if(overlapPercent > 99)
+		overlapPercent = 99;
 	else if(overlapPercent < 0)
-		m_overlapPercent = 0;
+		overlapPercent = 0;
 
 	m_fftSize = fftSize;
 	m_overlapPercent = overlapPercent;
 	m_fft->configure(m_fftSize, false);
 	m_window.create(window, m_fftSize);
-	m_overlapSize = (m_fftSize * m_overlapPercent) / 100;
+	m_fftBufferPos = 0;
+
+	// buffers only grow to the size actually configured
+	m_fftBuffer.assign(m_fftSize, Complex(0, 0));
+	m_powerSpectrum.resize(m_fftSize);
+	m_logPowerSpectrum.resize(m_fftSize);
+
+	m_averagingMode = averagingMode;
+	m_averagingCount = 0;
+	m_frameRate = frameRate;
+	applyRates();
+}
+
+void SpectrumVis::applyRates()
+{
+	// while the engine sheds load, no overlap and at most half the frames
+	if(m_shedding)
+		m_overlapSize = 0;
+	else m_overlapSize = (m_fftSize * m_overlapPercent) / 100;
 	m_refillSize = m_fftSize - m_overlapSize;
 	m_fftBufferFill = m_overlapSize;
+
+	if(m_frameRate > 0)
+		m_frameInterval = (m_shedding ? 2000 : 1000) / m_frameRate;
+	else if(m_shedding)
+		m_frameInterval = 1000 / SHEDDING_FRAME_RATE;
+	else m_frameInterval = 0;
+	m_nextFrame = 0;
+	m_frameTimer.start();
 }
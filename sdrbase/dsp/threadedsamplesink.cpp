@@ -1,11 +1,18 @@
 #include <QThread>
 #include "dsp/threadedsamplesink.h"
+#include "dsp/dspcommands.h"
 #include "util/message.h"
+#include "util/threadpolicy.h"
 
-ThreadedSampleSink::ThreadedSampleSink(SampleSink* sampleSink) :
+ThreadedSampleSink::ThreadedSampleSink(SampleSink* sampleSink, bool dropOldest) :
 	m_thread(new QThread),
-	m_sampleSink(sampleSink)
+	m_sampleSink(sampleSink),
+	m_feedTimeMetric(Metric::MtCounter, "sdr_sink_feed_microseconds_total", "Time spent in feed() of a sink"),
+	m_samplesMetric(Metric::MtCounter, "sdr_sink_samples_total", "Samples fed to a sink"),
+	m_scheduler()
 {
+	setMetricsName(Metrics::instanceName("threaded"));
+
 	moveToThread(m_thread);
 	connect(m_thread, SIGNAL(started()), this, SLOT(threadStarted()));
 	connect(m_thread, SIGNAL(finished()), this, SLOT(threadFinished()));
@@ -16,6 +23,9 @@ ThreadedSampleSink::ThreadedSampleSink(SampleSink* sampleSink) :
 	m_sampleFifo.moveToThread(m_thread);
 	connect(&m_sampleFifo, SIGNAL(dataReady()), this, SLOT(handleData()));
 	m_sampleFifo.setSize(128 * 1024);
+	// lossy sinks never hold back the engine - they skip ahead to the newest data instead
+	m_sampleFifo.setDropOldest(dropOldest);
+	m_sampleFifo.setLatencyStage(Latency::StSinkFifo);
 
 	sampleSink->moveToThread(m_thread);
 }
@@ -29,7 +39,9 @@ ThreadedSampleSink::~ThreadedSampleSink()
 
 void ThreadedSampleSink::feed(SampleVector::const_iterator begin, SampleVector::const_iterator end, bool firstOfBurst)
 {
-	Q_UNUSED(firstOfBurst);
+	// the gap is passed on by the reader of the fifo
+	if(firstOfBurst)
+		m_sampleFifo.markGap();
 	m_sampleFifo.write(begin, end);
 }
 
@@ -52,38 +64,59 @@ bool ThreadedSampleSink::handleMessage(Message* cmd)
 	return true;
 }
 
-void ThreadedSampleSink::handleData()
+void ThreadedSampleSink::setMetricsName(const QString& name)
 {
-	bool firstOfBurst = true;
-	QTime time;
+	QString labels = QString("sink=\"%1\"").arg(name);
+	m_feedTimeMetric.setLabels(labels);
+	m_samplesMetric.setLabels(labels);
+	m_sampleFifo.setMetricsName(name);
+	m_messageQueue.setMetricsName(name);
+	// engine -> fifo here, the work itself in the wrapped sink
+	m_profile.setName(name, "hand-off");
+	if(m_sampleSink != NULL)
+		m_sampleSink->getProfile()->setName(name, "processing");
+}
 
-	time.start();
+void ThreadedSampleSink::handleData()
+{
+	m_scheduler.beginBurst();
+	while(m_sampleFifo.fill() > 0) {
+		// messages first; once the budget is used up let the event loop run and come back
+		if((m_messageQueue.countPending() > 0) || m_scheduler.budgetExhausted()) {
+			QMetaObject::invokeMethod(this, "handleData", Qt::QueuedConnection);
+			break;
+		}
 
-	while((m_sampleFifo.fill() > 0) && (m_messageQueue.countPending() == 0) && (time.elapsed() < 250)) {
 		SampleVector::iterator part1begin;
 		SampleVector::iterator part1end;
 		SampleVector::iterator part2begin;
 		SampleVector::iterator part2end;
 
-		size_t count = m_sampleFifo.readBegin(m_sampleFifo.fill(), &part1begin, &part1end, &part2begin, &part2end);
+		m_scheduler.beginQuantum();
+		size_t count = m_sampleFifo.readBegin(qMin(m_sampleFifo.fill(), m_scheduler.quantumSize()), &part1begin, &part1end, &part2begin, &part2end);
+		bool firstOfBurst = m_sampleFifo.readAfterGap();
 
 		if(m_sampleSink != NULL) {
+			qint64 startTime = Latency::now();
 			// first part of FIFO data
 			if(part1begin != part1end) {
 				// handle data
-				m_sampleSink->feed(part1begin, part1end, firstOfBurst);
+				m_sampleSink->profiledFeed(part1begin, part1end, firstOfBurst);
 				firstOfBurst = false;
 			}
 			// second part of FIFO data (used when block wraps around)
 			if(part2begin != part2end) {
 				// handle data
-				m_sampleSink->feed(part2begin, part2end, firstOfBurst);
+				m_sampleSink->profiledFeed(part2begin, part2end, firstOfBurst);
 				firstOfBurst = false;
 			}
+			m_feedTimeMetric.add(Latency::now() - startTime);
+			m_samplesMetric.add(count);
 		}
 
 		// adjust FIFO pointers
 		m_sampleFifo.readCommit(count);
+		m_scheduler.endQuantum(count, m_sampleFifo.fill());
 	}
 }
 
@@ -92,6 +125,9 @@ void ThreadedSampleSink::handleMessages()
 	Message* message;
 	while((message = m_messageQueue.accept()) != NULL) {
 		//qDebug("CMD: %s", message->getIdentifier());
+		// the sink may complete the message right away, so look at it first
+		if(DSPSignalNotification* notification = DSPSignalNotification::cast(message))
+			m_scheduler.setSampleRate(notification->getSampleRate());
 		if(m_sampleSink != NULL) {
 			if(!m_sampleSink->handleMessage(message))
 				message->completed();
@@ -103,6 +139,7 @@ void ThreadedSampleSink::handleMessages()
 
 void ThreadedSampleSink::threadStarted()
 {
+	ThreadPolicy::apply(ThreadPolicy::TcSink, "sdr-sink");
 	if(m_sampleSink != NULL)
 		m_sampleSink->start();
 }
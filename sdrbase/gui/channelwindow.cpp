@@ -4,6 +4,7 @@
 #include <QResizeEvent>
 #include "gui/channelwindow.h"
 #include "gui/rollupwidget.h"
+#include "gui/sinkprofilewidget.h"
 
 ChannelWindow::ChannelWindow(QWidget* parent) :
 	QScrollArea(parent)
@@ -15,12 +16,16 @@ ChannelWindow::ChannelWindow(QWidget* parent) :
 	setBackgroundRole(QPalette::Base);
 	m_layout->setMargin(3);
 	m_layout->setSpacing(3);
+
+	m_profileWidget = new SinkProfileWidget(m_container);
+	m_profileWidget->setAutoHide(true);
+	m_layout->addWidget(m_profileWidget);
 }
 
 void ChannelWindow::addRollupWidget(QWidget* rollupWidget)
 {
 	rollupWidget->setParent(m_container);
-	m_container->layout()->addWidget(rollupWidget);
+	m_layout->insertWidget(m_layout->indexOf(m_profileWidget), rollupWidget);
 }
 
 void ChannelWindow::resizeEvent(QResizeEvent* event)
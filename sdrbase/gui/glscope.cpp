@@ -1,3 +1,6 @@
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
 #include <QPainter>
 #include <QMouseEvent>
 #include "gui/glscope.h"
@@ -10,9 +13,83 @@ static double log2f(double n)
 }
 #endif
 
+#ifdef USE_SIMD
+// atan2 with about 2e-4 rad error
+static inline __m128 atan2_ps(__m128 y, __m128 x)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 pi = _mm_set1_ps(M_PI);
+	const __m128 pi2 = _mm_set1_ps(M_PI / 2.0);
+
+	__m128 ax = _mm_andnot_ps(signMask, x);
+	__m128 ay = _mm_andnot_ps(signMask, y);
+	__m128 a = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+	__m128 s = _mm_mul_ps(a, a);
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0464964749f), s), _mm_set1_ps(0.15931422f));
+	r = _mm_sub_ps(_mm_mul_ps(r, s), _mm_set1_ps(0.327622764f));
+	r = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(r, s), a), a);
+
+	__m128 mask = _mm_cmpgt_ps(ay, ax);
+	r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(pi2, r)), _mm_andnot_ps(mask, r));
+	mask = _mm_cmplt_ps(x, _mm_setzero_ps());
+	r = _mm_or_ps(_mm_and_ps(mask, _mm_sub_ps(pi, r)), _mm_andnot_ps(mask, r));
+	return _mm_or_ps(r, _mm_and_ps(y, signMask));
+}
+
+// log2 for positive values with about 0.005 error - plenty for a dB display
+static inline __m128 log2_ps(__m128 v)
+{
+	__m128i bits = _mm_castps_si128(v);
+	__m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+	__m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.34484843f), m), _mm_set1_ps(2.02466578f));
+	p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.67487759f));
+	return _mm_add_ps(e, p);
+}
+#endif
+
+// dst = (magnitude, phase / pi), magnitude either linear or as (96 + dB) / 96
+static void magPhase(const Complex* src, Complex* dst, int count, bool dB)
+{
+	Real mult = (10.0f / log2f(10.0f));
+	int i = 0;
+
+#ifdef USE_SIMD
+	const __m128 multv = _mm_set1_ps(mult / 96.0);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 invPi = _mm_set1_ps(1.0 / M_PI);
+
+	for(; i + 4 <= count; i += 4) {
+		__m128 a = _mm_loadu_ps((const float*)&src[i]);
+		__m128 b = _mm_loadu_ps((const float*)&src[i + 2]);
+		__m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 mag = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+		if(dB)
+			mag = _mm_add_ps(one, _mm_mul_ps(multv, log2_ps(mag)));
+		else mag = _mm_sqrt_ps(mag);
+		__m128 pha = _mm_mul_ps(atan2_ps(im, re), invPi);
+		_mm_storeu_ps((float*)&dst[i], _mm_unpacklo_ps(mag, pha));
+		_mm_storeu_ps((float*)&dst[i + 2], _mm_unpackhi_ps(mag, pha));
+	}
+#endif
+
+	for(; i < count; i++) {
+		Real v;
+		if(dB) {
+			v = src[i].real() * src[i].real() + src[i].imag() * src[i].imag();
+			v = (96.0 + (mult * log2f(v))) / 96.0;
+		} else {
+			v = abs(src[i]);
+		}
+		dst[i] = Complex(v, arg(src[i]) / M_PI);
+	}
+}
+
 GLScope::GLScope(QWidget* parent) :
 	QGLWidget(parent),
 	m_dataChanged(false),
+	m_mathChanged(true),
 	m_configChanged(true),
 	m_mode(ModeIQ),
 	m_orientation(Qt::Horizontal),
@@ -24,7 +101,11 @@ GLScope::GLScope(QWidget* parent) :
 	m_amp(1.0),
 	m_timeBase(1),
 	m_timeOfsProMill(0),
-	m_triggerChannel(ScopeVis::TriggerFreeRun)
+	m_triggerChannel(ScopeVis::TriggerFreeRun),
+	m_triggerLevelHigh(0.0),
+	m_triggerLevelLow(0.0),
+	m_traceSize(100000),
+	m_triggerPre(0)
 {
 	setAttribute(Qt::WA_OpaquePaintEvent);
 	connect(&m_timer, SIGNAL(timeout()), this, SLOT(tick()));
@@ -45,6 +126,7 @@ void GLScope::setDSPEngine(DSPEngine* dspEngine)
 		m_dspEngine = dspEngine;
 		m_scopeVis = new ScopeVis(this);
 		m_dspEngine->addSink(m_scopeVis);
+		m_scopeVis->configure(m_dspEngine->getMessageQueue(), m_triggerChannel, m_triggerLevelHigh, m_triggerLevelLow, m_traceSize, m_triggerPre);
 	}
 }
 
@@ -70,6 +152,7 @@ void GLScope::setMode(Mode mode)
 {
 	m_mode = mode;
 	m_dataChanged = true;
+	m_mathChanged = true;
 	update();
 }
 
@@ -80,7 +163,19 @@ void GLScope::setOrientation(Qt::Orientation orientation)
 	update();
 }
 
-void GLScope::newTrace(const std::vector<Complex>& trace, int sampleRate)
+void GLScope::setTrigger(ScopeVis::TriggerChannel triggerChannel, Real triggerLevelHigh, Real triggerLevelLow, int traceSize, int triggerPre)
+{
+	m_triggerChannel = triggerChannel;
+	m_triggerLevelHigh = triggerLevelHigh;
+	m_triggerLevelLow = triggerLevelLow;
+	m_traceSize = traceSize;
+	m_triggerPre = triggerPre;
+	if(m_dspEngine != NULL)
+		m_scopeVis->configure(m_dspEngine->getMessageQueue(), m_triggerChannel, m_triggerLevelHigh, m_triggerLevelLow, m_traceSize, m_triggerPre);
+	update();
+}
+
+void GLScope::newTrace(std::vector<Complex>& trace, int sampleRate)
 {
 	if(!m_mutex.tryLock(2))
 		return;
@@ -89,10 +184,11 @@ void GLScope::newTrace(const std::vector<Complex>& trace, int sampleRate)
 		return;
 	}
 
-	m_rawTrace = trace;
+	m_rawTrace.swap(trace);
 
 	m_sampleRate = sampleRate;
 	m_dataChanged = true;
+	m_mathChanged = true;
 
 	m_mutex.unlock();
 }
@@ -201,18 +297,7 @@ void GLScope::paintGL()
 		int end = start + m_displayTrace->size() / m_timeBase;
 		if(end - start < 2)
 			start--;
-		float posLimit = 1.0 / m_amp1;
-		float negLimit = -1.0 / m_amp1;
-		glBegin(GL_LINE_STRIP);
-		for(int i = start; i < end; i++) {
-			float v = (*m_displayTrace)[i].real() + m_ofs1;
-			if(v > posLimit)
-				v = posLimit;
-			else if(v < negLimit)
-				v = negLimit;
-			glVertex2f(i - start, v);
-		}
-		glEnd();
+		drawTrace(start, end, false, m_ofs1, m_amp1, m_glScopeRect1.width() * width());
 		glDisable(GL_LINE_SMOOTH);
 		glPopMatrix();
 	}
@@ -288,77 +373,89 @@ void GLScope::paintGL()
 		int end = start + m_displayTrace->size() / m_timeBase;
 		if(end - start < 2)
 			start--;
-		float posLimit = 1.0 / m_amp2;
-		float negLimit = -1.0 / m_amp2;
-		glBegin(GL_LINE_STRIP);
+		drawTrace(start, end, true, m_ofs2, m_amp2, m_glScopeRect2.width() * width());
+		glDisable(GL_LINE_SMOOTH);
+		glPopMatrix();
+	}
+
+	glPopMatrix();
+	m_dataChanged = false;
+	m_mutex.unlock();
+}
+
+void GLScope::drawTrace(int start, int end, bool imag, Real ofs, Real amp, int pixels)
+{
+	float posLimit = 1.0 / amp;
+	float negLimit = -1.0 / amp;
+	const Real* values = (const Real*)&(*m_displayTrace)[0] + (imag ? 1 : 0);
+	int count = end - start;
+
+	glBegin(GL_LINE_STRIP);
+	if((pixels > 0) && (count > 2 * pixels)) {
+		// more than two samples per pixel - draw the min/max envelope of every pixel column
+		for(int p = 0; p < pixels; p++) {
+			int first = start + (int)(((qint64)p * count) / pixels);
+			int last = start + (int)(((qint64)(p + 1) * count) / pixels);
+			float min = values[2 * first];
+			float max = min;
+			for(int i = first + 1; i < last; i++) {
+				float v = values[2 * i];
+				if(v < min)
+					min = v;
+				else if(v > max)
+					max = v;
+			}
+			min += ofs;
+			max += ofs;
+			if(min < negLimit)
+				min = negLimit;
+			else if(min > posLimit)
+				min = posLimit;
+			if(max > posLimit)
+				max = posLimit;
+			else if(max < negLimit)
+				max = negLimit;
+			glVertex2f(first - start, min);
+			glVertex2f(first - start, max);
+		}
+	} else {
 		for(int i = start; i < end; i++) {
-			float v = (*m_displayTrace)[i].imag();
+			float v = values[2 * i] + ofs;
 			if(v > posLimit)
 				v = posLimit;
 			else if(v < negLimit)
 				v = negLimit;
 			glVertex2f(i - start, v);
 		}
-		glEnd();
-		glDisable(GL_LINE_SMOOTH);
-		glPopMatrix();
 	}
-
-	glPopMatrix();
-	m_dataChanged = false;
-	m_mutex.unlock();
+	glEnd();
 }
 
 void GLScope::mousePressEvent(QMouseEvent* event)
 {
-#if 0
-	int x = event->x() - 10;
-	int y = event->y() - 10;
-	Real time;
-	Real amplitude;
-	ScopeVis::TriggerChannel channel;
-	if((x < 0) || (x >= width() - 20))
+	// a click into the I or Q trace asks for a trigger at that level, the owner of the scope
+	// applies it so its controls stay in sync
+	if((m_mode != ModeIQ) || (m_amp1 == 0))
 		return;
-	if((y < 0) || (y >= height() - 20))
-		return;
-
-	if((m_sampleRate != 0) && (m_timeBase != 0) && (width() > 20))
-		time = ((Real)x * (Real)m_displayTrace->size()) / ((Real)m_sampleRate * (Real)m_timeBase * (Real)(width() - 20));
-	else time = -1.0;
 
-	if(y < (height() - 30) / 2) {
+	QRectF rect1(m_glScopeRect1.x() * width(), m_glScopeRect1.y() * height(), m_glScopeRect1.width() * width(), m_glScopeRect1.height() * height());
+	QRectF rect2(m_glScopeRect2.x() * width(), m_glScopeRect2.y() * height(), m_glScopeRect2.width() * width(), m_glScopeRect2.height() * height());
+	ScopeVis::TriggerChannel channel;
+	QRectF rect;
+	if(rect1.contains(event->pos())) {
 		channel = ScopeVis::TriggerChannelI;
-		if((m_amp != 0) && (height() > 30))
-			amplitude = 2.0 * ((height() - 30) * 0.25 - (Real)y) / (m_amp * (height() - 30) / 2.0);
-		else amplitude = -1;
-	} else if(y > (height() - 30) / 2 + 10) {
-		y -= 10 + (height() - 30) / 2;
+		rect = rect1;
+	} else if(rect2.contains(event->pos())) {
 		channel = ScopeVis::TriggerChannelQ;
-		if((m_amp != 0) && (height() > 30))
-			amplitude = 2.0 * ((height() - 30) * 0.25 - (Real)y) / (m_amp * (height() - 30) / 2.0);
-		else amplitude = -1;
+		rect = rect2;
 	} else {
-		channel = ScopeVis::TriggerFreeRun;
+		return;
 	}
 
-	if(m_dspEngine != NULL) {
-		qDebug("amp %f", amplitude);
-		m_triggerLevelHigh = amplitude + 0.01 / m_amp;
-		m_triggerLevelLow = amplitude - 0.01 / m_amp;
-		if(m_triggerLevelHigh > 1.0)
-			m_triggerLevelHigh = 1.0;
-		else if(m_triggerLevelHigh < -1.0)
-			m_triggerLevelHigh = -1.0;
-		if(m_triggerLevelLow > 1.0)
-			m_triggerLevelLow = 1.0;
-		else if(m_triggerLevelLow < -1.0)
-			m_triggerLevelLow = -1.0;
-		m_scopeVis->configure(m_dspEngine->getMessageQueue(), channel, m_triggerLevelHigh, m_triggerLevelLow);
-		m_triggerChannel = channel;
-		m_changed = true;
-		update();
-	}
-#endif
+	// inverse of the scaling in paintGL()
+	Real level = (rect.y() + rect.height() / 2.0 - event->y()) / ((rect.height() / 2.0) * m_amp1);
+	int percent = qBound(-100, qRound(level * 100.0), 100);
+	emit triggerPicked(channel, percent);
 }
 
 void GLScope::handleMode()
@@ -372,27 +469,24 @@ void GLScope::handleMode()
 			m_ofs2 = 0.0;
 			break;
 
-		case ModeMagLinPha: {
-			m_mathTrace.resize(m_rawTrace.size());
-			std::vector<Complex>::iterator dst = m_mathTrace.begin();
-			for(std::vector<Complex>::const_iterator src = m_rawTrace.begin(); src != m_rawTrace.end(); ++src)
-				*dst++ = Complex(abs(*src), arg(*src) / M_PI);
+		case ModeMagLinPha:
+			if(m_mathChanged) {
+				m_mathTrace.resize(m_rawTrace.size());
+				if(m_rawTrace.size() > 0)
+					magPhase(&m_rawTrace[0], &m_mathTrace[0], m_rawTrace.size(), false);
+			}
 			m_displayTrace = &m_mathTrace;
 			m_amp1 = m_amp;
 			m_amp2 = 1.0;
 			m_ofs1 = -1.0 / m_amp1;
 			m_ofs2 = 0.0;
 			break;
-		}
 
-		case ModeMagdBPha: {
-			m_mathTrace.resize(m_rawTrace.size());
-			std::vector<Complex>::iterator dst = m_mathTrace.begin();
-			Real mult = (10.0f / log2f(10.0f));
-			for(std::vector<Complex>::const_iterator src = m_rawTrace.begin(); src != m_rawTrace.end(); ++src) {
-				Real v = src->real() * src->real() + src->imag() * src->imag();
-				v = (96.0 + (mult * log2f(v))) / 96.0;
-				*dst++ = Complex(v, arg(*src) / M_PI);
+		case ModeMagdBPha:
+			if(m_mathChanged) {
+				m_mathTrace.resize(m_rawTrace.size());
+				if(m_rawTrace.size() > 0)
+					magPhase(&m_rawTrace[0], &m_mathTrace[0], m_rawTrace.size(), true);
 			}
 			m_displayTrace = &m_mathTrace;
 			m_amp1 = 2.0 * m_amp;
@@ -400,16 +494,17 @@ void GLScope::handleMode()
 			m_ofs1 = -1.0 / m_amp1;
 			m_ofs2 = 0.0;
 			break;
-		}
 
 		case ModeDerived12: {
 			if(m_rawTrace.size() > 3) {
-				m_mathTrace.resize(m_rawTrace.size() - 3);
-				std::vector<Complex>::iterator dst = m_mathTrace.begin();
-				for(uint i = 3; i < m_rawTrace.size() ; i++) {
-					*dst++ = Complex(
-						abs(m_rawTrace[i] - m_rawTrace[i - 1]),
-						abs(m_rawTrace[i] - m_rawTrace[i - 1]) - abs(m_rawTrace[i - 2] - m_rawTrace[i - 3]));
+				if(m_mathChanged) {
+					m_mathTrace.resize(m_rawTrace.size() - 3);
+					std::vector<Complex>::iterator dst = m_mathTrace.begin();
+					for(uint i = 3; i < m_rawTrace.size() ; i++) {
+						*dst++ = Complex(
+							abs(m_rawTrace[i] - m_rawTrace[i - 1]),
+							abs(m_rawTrace[i] - m_rawTrace[i - 1]) - abs(m_rawTrace[i - 2] - m_rawTrace[i - 3]));
+					}
 				}
 				m_displayTrace = &m_mathTrace;
 				m_amp1 = m_amp;
@@ -422,10 +517,12 @@ void GLScope::handleMode()
 
 		case ModeCyclostationary: {
 			if(m_rawTrace.size() > 2) {
-				m_mathTrace.resize(m_rawTrace.size() - 2);
-				std::vector<Complex>::iterator dst = m_mathTrace.begin();
-				for(uint i = 2; i < m_rawTrace.size() ; i++)
-					*dst++ = Complex(abs(m_rawTrace[i] - conj(m_rawTrace[i - 1])), 0);
+				if(m_mathChanged) {
+					m_mathTrace.resize(m_rawTrace.size() - 2);
+					std::vector<Complex>::iterator dst = m_mathTrace.begin();
+					for(uint i = 2; i < m_rawTrace.size() ; i++)
+						*dst++ = Complex(abs(m_rawTrace[i] - conj(m_rawTrace[i - 1])), 0);
+				}
 				m_displayTrace = &m_mathTrace;
 				m_amp1 = m_amp;
 				m_amp2 = m_amp;
@@ -436,6 +533,9 @@ void GLScope::handleMode()
 		}
 
 	}
+
+	// the derived traces are only recomputed when a new trace arrives or the mode changes
+	m_mathChanged = false;
 }
 
 void GLScope::applyConfig()
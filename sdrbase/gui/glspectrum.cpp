@@ -20,6 +20,7 @@
 #endif
 #include <QMouseEvent>
 #include "gui/glspectrum.h"
+#include "util/trace.h"
 
 GLSpectrum::GLSpectrum(QWidget* parent) :
 	QGLWidget(parent),
@@ -32,6 +33,7 @@ GLSpectrum::GLSpectrum(QWidget* parent) :
 	m_decay(0),
 	m_sampleRate(500000),
 	m_fftSize(512),
+	m_displayWidth(0),
 	m_displayGrid(true),
 	m_invertedWaterfall(false),
 	m_displayMaxHold(false),
@@ -247,40 +249,49 @@ void GLSpectrum::removeChannelMarker(ChannelMarker* channelMarker)
 
 void GLSpectrum::newSpectrum(const std::vector<Real>& spectrum, int fftSize)
 {
-	QMutexLocker mutexLocker(&m_mutex);
-
-	m_displayChanged = true;
-
-	if(m_changesPending) {
-		m_fftSize = fftSize;
-		return;
-	}
-
-	if(fftSize != m_fftSize) {
-		m_fftSize = fftSize;
-		m_changesPending = true;
-		return;
-	}
-
-	updateWaterfall(spectrum);
-	updateHistogram(spectrum);
+	// called from the spectrum thread - never blocks, the GUI picks up the newest frame
+	SpectrumFrame& frame = m_spectrumMailbox.writeBuffer();
+	if(frame.m_spectrum.size() < (size_t)fftSize)
+		frame.m_spectrum.resize(fftSize);
+	std::copy(spectrum.begin(), spectrum.begin() + fftSize, frame.m_spectrum.begin());
+	frame.m_fftSize = fftSize;
+	m_spectrumMailbox.publish();
 }
 
 void GLSpectrum::updateWaterfall(const std::vector<Real>& spectrum)
 {
 	if(m_waterfallBufferPos < m_waterfallBuffer->height()) {
 		quint32* pix = (quint32*)m_waterfallBuffer->scanLine(m_waterfallBufferPos);
+		Real scale = 240.0 / m_powerRange;
+		int i = 0;
 
-		for(int i = 0; i < m_fftSize; i++) {
-			Real vr = (int)((spectrum[i] - m_referenceLevel) * 2.4 * 100.0 / m_powerRange + 240.0);
-			int v = (int)vr;
+#ifdef USE_SIMD
+		const __m128 refl = _mm_set1_ps(m_referenceLevel);
+		const __m128 mul = _mm_set1_ps(scale);
+		const __m128 offset = _mm_set1_ps(240.0f);
+		const __m128i lo = _mm_setzero_si128();
+		const __m128i hi = _mm_set1_epi16(239);
+
+		for(; i + 8 <= m_fftSize; i += 8) {
+			__m128 a = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&spectrum[i]), refl), mul), offset);
+			__m128 b = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&spectrum[i + 4]), refl), mul), offset);
+			__m128i v = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+			v = _mm_min_epi16(_mm_max_epi16(v, lo), hi);
+			qint16 idx[8];
+			_mm_storeu_si128((__m128i*)idx, v);
+			for(int j = 0; j < 8; j++)
+				pix[i + j] = m_waterfallPalette[idx[j]];
+		}
+#endif
+		for(; i < m_fftSize; i++) {
+			int v = (int)((spectrum[i] - m_referenceLevel) * scale + 240.0);
 
 			if(v > 239)
 				v = 239;
 			else if(v < 0)
 				v = 0;
 
-			*pix++ = m_waterfallPalette[(int)v];
+			pix[i] = m_waterfallPalette[v];
 		}
 
 		m_waterfallBufferPos++;
@@ -289,6 +300,7 @@ void GLSpectrum::updateWaterfall(const std::vector<Real>& spectrum)
 
 void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 {
+	// m_histogram is power-major: row v (0..99) holds one byte per FFT bin
 	quint8* b = m_histogram;
 	quint8* h = m_histogramHoldoff;
 	int sub = 1;
@@ -298,21 +310,47 @@ void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 
 	m_histogramHoldoffCount--;
 	if(m_histogramHoldoffCount <= 0) {
-		for(int i = 0; i < 100 * m_fftSize; i++) {
-			if(*b > 20) {
-				*b = *b - sub;
-			} else if(*b > 0) {
-				if(*h >= sub) {
-					*h = *h - sub;
-				} else if(*h > 0) {
-					*h = *h - 1;
+		int size = 100 * m_fftSize;
+		int i = 0;
+#ifdef USE_SIMD
+		// cells above 20 fade by sub, dimmer cells only lose 1 whenever their holdoff expires
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i subv = _mm_set1_epi8(sub);
+		const __m128i threshold = _mm_set1_epi8(21);
+		const __m128i late = _mm_set1_epi8(m_histogramLateHoldoff);
+
+		for(; i + 16 <= size; i += 16) {
+			__m128i bv = _mm_loadu_si128((__m128i*)(b + i));
+			__m128i hv = _mm_loadu_si128((__m128i*)(h + i));
+
+			__m128i high = _mm_cmpeq_epi8(_mm_max_epu8(bv, threshold), bv);
+			__m128i low = _mm_andnot_si128(_mm_or_si128(high, _mm_cmpeq_epi8(bv, zero)), _mm_cmpeq_epi8(bv, bv));
+			__m128i expired = _mm_and_si128(low, _mm_cmpeq_epi8(hv, zero));
+			__m128i hGeSub = _mm_cmpeq_epi8(_mm_max_epu8(hv, subv), hv);
+			__m128i hNext = _mm_or_si128(_mm_and_si128(hGeSub, _mm_subs_epu8(hv, subv)), _mm_andnot_si128(hGeSub, _mm_subs_epu8(hv, one)));
+
+			bv = _mm_or_si128(_mm_and_si128(high, _mm_subs_epu8(bv, subv)), _mm_andnot_si128(high, _mm_subs_epu8(bv, _mm_and_si128(expired, one))));
+			hNext = _mm_or_si128(_mm_and_si128(expired, late), _mm_andnot_si128(expired, hNext));
+			hv = _mm_or_si128(_mm_and_si128(low, hNext), _mm_andnot_si128(low, hv));
+
+			_mm_storeu_si128((__m128i*)(b + i), bv);
+			_mm_storeu_si128((__m128i*)(h + i), hv);
+		}
+#endif
+		for(; i < size; i++) {
+			if(b[i] > 20) {
+				b[i] = b[i] - sub;
+			} else if(b[i] > 0) {
+				if(h[i] >= sub) {
+					h[i] = h[i] - sub;
+				} else if(h[i] > 0) {
+					h[i] = h[i] - 1;
 				} else {
-					*b = *b - 1;
-					*h = m_histogramLateHoldoff;
+					b[i] = b[i] - 1;
+					h[i] = m_histogramLateHoldoff;
 				}
 			}
-			b++;
-			h++;
 		}
 		m_histogramHoldoffCount = m_histogramHoldoffBase;
 	}
@@ -322,7 +360,7 @@ void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 		int v = (int)((spectrum[i] - m_referenceLevel) * 100.0 / m_powerRange + 100.0);
 
 		if((v >= 0) && (v <= 99)) {
-			b = m_histogram + i * 100 + v;
+			b = m_histogram + v * m_fftSize + i;
 			if(*b < 220)
 				*b += 4;
 			else if(*b < 239)
@@ -346,7 +384,7 @@ void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 			for(int j = 0; j < 4; j++) {
 				int v = ((int*)&result)[j];
 				if((v >= 0) && (v <= 99)) {
-					b = m_histogram + (i + j) * 100 + v;
+					b = m_histogram + v * m_fftSize + i + j;
 					if(*b < 220)
 						*b += 4;
 					else if(*b < 239)
@@ -356,6 +394,7 @@ void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 		}
 	} else { // draw double pixels
 		int add = -m_decay * 4;
+		int row = m_fftSize;
 		const __m128 refl = {m_referenceLevel, m_referenceLevel, m_referenceLevel, m_referenceLevel};
 		const __m128 power = {m_powerRange, m_powerRange, m_powerRange, m_powerRange};
 		const __m128 mul = {100.0f, 100.0f, 100.0f, 100.0f};
@@ -371,21 +410,21 @@ void GLSpectrum::updateHistogram(const std::vector<Real>& spectrum)
 			for(int j = 0; j < 4; j++) {
 				int v = ((int*)&result)[j];
 				if((v >= 1) && (v <= 98)) {
-					b = m_histogram + (i + j) * 100 + v;
-					if(b[-1] < 220)
-						b[-1] += add;
-					else if(b[-1] < 239)
-						b[-1] += 1;
+					b = m_histogram + v * m_fftSize + i + j;
+					if(b[-row] < 220)
+						b[-row] += add;
+					else if(b[-row] < 239)
+						b[-row] += 1;
 					if(b[0] < 220)
 						b[0] += add;
 					else if(b[0] < 239)
 						b[0] += 1;
-					if(b[1] < 220)
-						b[1] += add;
-					else if(b[1] < 239)
-						b[1] += 1;
+					if(b[row] < 220)
+						b[row] += add;
+					else if(b[row] < 239)
+						b[row] += 1;
 				} else if((v >= 0) && (v <= 99)) {
-					b = m_histogram + (i + j) * 100 + v;
+					b = m_histogram + v * m_fftSize + i + j;
 					if(*b < 220)
 						*b += add;
 					else if(*b < 239)
@@ -411,9 +450,17 @@ void GLSpectrum::resizeGL(int width, int height)
 
 void GLSpectrum::paintGL()
 {
+	TRACE_SCOPE("GLSpectrum::paintGL");
 	if(!m_mutex.tryLock(2))
 		return;
 
+	bool newFrame = m_spectrumMailbox.update();
+	const SpectrumFrame& frame = m_spectrumMailbox.readBuffer();
+	if(newFrame && (frame.m_fftSize != m_fftSize)) {
+		m_fftSize = frame.m_fftSize;
+		m_changesPending = true;
+	}
+
 	if(m_changesPending)
 		applyChanges();
 
@@ -422,6 +469,11 @@ void GLSpectrum::paintGL()
 		return;
 	}
 
+	if(newFrame) {
+		updateWaterfall(frame.m_spectrum);
+		updateHistogram(frame.m_spectrum);
+	}
+
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 	glClear(GL_COLOR_BUFFER_BIT);
 
@@ -440,11 +492,22 @@ void GLSpectrum::paintGL()
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-		for(int i = 0; i < m_waterfallBufferPos; i++) {
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_waterfallTexturePos, m_fftSize, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_waterfallBuffer->scanLine(i));
-			m_waterfallTexturePos = (m_waterfallTexturePos + 1) % m_waterfallTextureHeight;
+		// upload the pending lines as at most two blocks - the texture is used as a ring
+		if(m_waterfallBufferPos > 0) {
+			int first = 0;
+			int lines = m_waterfallBufferPos;
+			if(lines > m_waterfallTextureHeight) {
+				first = lines - m_waterfallTextureHeight;
+				m_waterfallTexturePos = (m_waterfallTexturePos + first) % m_waterfallTextureHeight;
+				lines = m_waterfallTextureHeight;
+			}
+			int block = std::min(lines, m_waterfallTextureHeight - m_waterfallTexturePos);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_waterfallTexturePos, m_fftSize, block, GL_RGBA, GL_UNSIGNED_BYTE, m_waterfallBuffer->scanLine(first));
+			if(lines > block)
+				glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_fftSize, lines - block, GL_RGBA, GL_UNSIGNED_BYTE, m_waterfallBuffer->scanLine(first + block));
+			m_waterfallTexturePos = (m_waterfallTexturePos + lines) % m_waterfallTextureHeight;
+			m_waterfallBufferPos = 0;
 		}
-		m_waterfallBufferPos = 0;
 		float prop_y = m_waterfallTexturePos / (m_waterfallTextureHeight - 1.0);
 		float off = 1.0 / (m_waterfallTextureHeight - 1.0);
 		glEnable(GL_TEXTURE_2D);
@@ -505,18 +568,12 @@ void GLSpectrum::paintGL()
 		glTranslatef(m_glHistogramRect.x(), m_glHistogramRect.y(), 0);
 		glScalef(m_glHistogramRect.width(), m_glHistogramRect.height(), 1);
 		if(m_displayHistogram) {
-			// import new lines into the texture
-			quint32* pix;
-			quint8* bs = m_histogram;
+			// import new lines into the texture - one histogram row per texture row
 			for(int y = 0; y < 100; y++) {
-				quint8* b = bs;
-				pix = (quint32*)m_histogramBuffer->scanLine(99 - y);
-				for(int x = 0; x < m_fftSize; x++) {
-					*pix = m_histogramPalette[*b];
-					pix++;
-					b += 100;
-				}
-				bs++;
+				const quint8* b = m_histogram + y * m_fftSize;
+				quint32* pix = (quint32*)m_histogramBuffer->scanLine(99 - y);
+				for(int x = 0; x < m_fftSize; x++)
+					pix[x] = m_histogramPalette[b[x]];
 			}
 
 			// draw texture
@@ -668,17 +725,19 @@ void GLSpectrum::paintGL()
 	if(m_displayMaxHold) {
 		if(m_maxHold.size() < m_fftSize)
 			m_maxHold.resize(m_fftSize);
-		for(int i = 0; i < m_fftSize; i++) {
-			int j;
-			quint8* bs = m_histogram + i * 100;
-			for(j = 99; j > 1; j--) {
-				if(bs[j] > 0)
-					break;
+		// find the highest populated row per bin, walking the rows bottom up
+		for(int i = 0; i < m_fftSize; i++)
+			m_maxHold[i] = 1;
+		for(int j = 2; j < 100; j++) {
+			const quint8* bs = m_histogram + j * m_fftSize;
+			for(int i = 0; i < m_fftSize; i++) {
+				if(bs[i] > 0)
+					m_maxHold[i] = j;
 			}
-			// TODO: ((bs[j] * (float)j) + (bs[j + 1] * (float)(j + 1))) / (bs[j] +  bs[j + 1])
-			j = j - 99;
-			m_maxHold[i] = (j * m_powerRange) / 99.0 + m_referenceLevel;
 		}
+		// TODO: ((bs[j] * (float)j) + (bs[j + 1] * (float)(j + 1))) / (bs[j] +  bs[j + 1])
+		for(int i = 0; i < m_fftSize; i++)
+			m_maxHold[i] = ((m_maxHold[i] - 99) * m_powerRange) / 99.0 + m_referenceLevel;
 
 		glPushMatrix();
 		glTranslatef(m_glHistogramRect.x(), m_glHistogramRect.y(), 0);
@@ -992,6 +1051,8 @@ void GLSpectrum::applyChanges()
 		waterfallHeight = 0;
 	}
 
+	m_displayWidth.storeRelease(width() - leftMargin - rightMargin);
+
 	// channel overlays
 	for(int i = 0; i < m_channelMarkerStates.size(); ++i) {
 		ChannelMarkerState* dv = m_channelMarkerStates[i];
@@ -1261,7 +1322,7 @@ void GLSpectrum::leaveEvent(QEvent* event)
 
 void GLSpectrum::tick()
 {
-	if(m_displayChanged) {
+	if(m_displayChanged || m_spectrumMailbox.pending()) {
 		m_displayChanged = false;
 		update();
 	}
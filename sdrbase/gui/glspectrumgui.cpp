@@ -5,6 +5,9 @@
 #include "util/simpleserializer.h"
 #include "ui_glspectrumgui.h"
 
+static const int frameRates[] = { 0, 50, 25, 10, 5 };
+static const int numFrameRates = sizeof(frameRates) / sizeof(frameRates[0]);
+
 GLSpectrumGUI::GLSpectrumGUI(QWidget* parent) :
 	QWidget(parent),
 	ui(new Ui::GLSpectrumGUI),
@@ -22,7 +25,9 @@ GLSpectrumGUI::GLSpectrumGUI(QWidget* parent) :
 	m_displayMaxHold(true),
 	m_displayHistogram(true),
 	m_displayGrid(true),
-	m_invert(false)
+	m_invert(false),
+	m_averagingMode(SpectrumVis::AvgNone),
+	m_frameRate(0)
 {
 	ui->setupUi(this);
 	for(int ref = 0; ref >= -95; ref -= 5)
@@ -58,6 +63,8 @@ void GLSpectrumGUI::resetToDefaults()
 	m_displayHistogram = true;
 	m_displayGrid = true;
 	m_invert = false;
+	m_averagingMode = SpectrumVis::AvgNone;
+	m_frameRate = 0;
 	applySettings();
 }
 
@@ -76,6 +83,8 @@ QByteArray GLSpectrumGUI::serialize() const
 	s.writeS32(10, m_decay);
 	s.writeBool(11, m_displayGrid);
 	s.writeBool(12, m_invert);
+	s.writeS32(13, m_averagingMode);
+	s.writeS32(14, m_frameRate);
 	return s.final();
 }
 
@@ -101,6 +110,8 @@ bool GLSpectrumGUI::deserialize(const QByteArray& data)
 		d.readS32(10, &m_decay, 0);
 		d.readBool(11, &m_displayGrid, true);
 		d.readBool(12, &m_invert, false);
+		d.readS32(13, &m_averagingMode, SpectrumVis::AvgNone);
+		d.readS32(14, &m_frameRate, 0);
 		applySettings();
 		return true;
 	} else {
@@ -112,7 +123,7 @@ bool GLSpectrumGUI::deserialize(const QByteArray& data)
 void GLSpectrumGUI::applySettings()
 {
 	ui->fftWindow->setCurrentIndex(m_fftWindow);
-	for(int i = 0; i < 7; i++) {
+	for(int i = 0; i < ui->fftSize->count(); i++) {
 		if(m_fftSize == (1 << (i + 7))) {
 			ui->fftSize->setCurrentIndex(i);
 			break;
@@ -121,6 +132,13 @@ void GLSpectrumGUI::applySettings()
 	ui->refLevel->setCurrentIndex(-m_refLevel / 5);
 	ui->levelRange->setCurrentIndex((100 - m_powerRange) / 5);
 	ui->decay->setCurrentIndex(m_decay + 2);
+	ui->averaging->setCurrentIndex(m_averagingMode);
+	for(int i = 0; i < numFrameRates; i++) {
+		if(m_frameRate == frameRates[i]) {
+			ui->frameRate->setCurrentIndex(i);
+			break;
+		}
+	}
 	ui->waterfall->setChecked(m_displayWaterfall);
 	ui->maxHold->setChecked(m_displayMaxHold);
 	ui->histogram->setChecked(m_displayHistogram);
@@ -135,7 +153,8 @@ void GLSpectrumGUI::applySettings()
 	m_glSpectrum->setInvertedWaterfall(m_invert);
 	m_glSpectrum->setDisplayGrid(m_displayGrid);
 
-	m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow);
+	m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow,
+		(SpectrumVis::AveragingMode)m_averagingMode, m_frameRate);
 }
 
 void GLSpectrumGUI::on_fftWindow_currentIndexChanged(int index)
@@ -143,14 +162,16 @@ void GLSpectrumGUI::on_fftWindow_currentIndexChanged(int index)
 	m_fftWindow = index;
 	if(m_spectrumVis == NULL)
 		return;
-	m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow);
+	m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow,
+		(SpectrumVis::AveragingMode)m_averagingMode, m_frameRate);
 }
 
 void GLSpectrumGUI::on_fftSize_currentIndexChanged(int index)
 {
 	m_fftSize = 1 << (7 + index);
 	if(m_spectrumVis != NULL)
-		m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow);
+		m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow,
+			(SpectrumVis::AveragingMode)m_averagingMode, m_frameRate);
 }
 
 void GLSpectrumGUI::on_refLevel_currentIndexChanged(int index)
@@ -174,6 +195,24 @@ void GLSpectrumGUI::on_decay_currentIndexChanged(int index)
 		m_glSpectrum->setDecay(m_decay);
 }
 
+void GLSpectrumGUI::on_averaging_currentIndexChanged(int index)
+{
+	m_averagingMode = index;
+	if(m_spectrumVis != NULL)
+		m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow,
+			(SpectrumVis::AveragingMode)m_averagingMode, m_frameRate);
+}
+
+void GLSpectrumGUI::on_frameRate_currentIndexChanged(int index)
+{
+	if((index < 0) || (index >= numFrameRates))
+		return;
+	m_frameRate = frameRates[index];
+	if(m_spectrumVis != NULL)
+		m_spectrumVis->configure(m_messageQueue, m_fftSize, m_fftOverlap, (FFTWindow::Function)m_fftWindow,
+			(SpectrumVis::AveragingMode)m_averagingMode, m_frameRate);
+}
+
 void GLSpectrumGUI::on_waterfall_toggled(bool checked)
 {
 	m_displayWaterfall = checked;
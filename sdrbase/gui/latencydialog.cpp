@@ -0,0 +1,65 @@
+#include "gui/latencydialog.h"
+#include "ui_latencydialog.h"
+#include "util/latency.h"
+#include "util/messagepool.h"
+#include "util/spinlock.h"
+
+LatencyDialog::LatencyDialog(QWidget* parent) :
+	QDialog(parent),
+	ui(new Ui::LatencyDialog),
+	m_updateTimer()
+{
+	ui->setupUi(this);
+
+	ui->enable->setChecked(Latency::isEnabled());
+	for(int i = 0; i < Latency::StCount; i++) {
+		QTreeWidgetItem* item = new QTreeWidgetItem(ui->tree);
+		item->setText(0, tr(Latency::stageName((Latency::Stage)i)));
+		for(int column = 1; column < ui->tree->columnCount(); column++)
+			item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+	}
+	updateTable();
+	ui->tree->resizeColumnToContents(0);
+
+	connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(updateTable()));
+	m_updateTimer.start(500);
+}
+
+LatencyDialog::~LatencyDialog()
+{
+	delete ui;
+}
+
+void LatencyDialog::updateTable()
+{
+	for(int i = 0; i < Latency::StCount; i++) {
+		const LatencyHistogram& histogram = Latency::histogram((Latency::Stage)i);
+		QTreeWidgetItem* item = ui->tree->topLevelItem(i);
+		item->setText(1, QString::number(histogram.count()));
+		item->setText(2, QString::number(histogram.percentile(0.5) / 1000.0, 'f', 2));
+		item->setText(3, QString::number(histogram.percentile(0.99) / 1000.0, 'f', 2));
+		item->setText(4, QString::number(histogram.maximum() / 1000.0, 'f', 2));
+	}
+	ui->lockStats->setText(tr("Message pool locks: %1 contended, %2 spins")
+		.arg(MessagePool::getLockContended())
+		.arg(MessagePool::getLockSpins()));
+}
+
+void LatencyDialog::on_enable_toggled(bool checked)
+{
+	Latency::setEnabled(checked);
+	Spinlock::setStatsEnabled(checked);
+}
+
+void LatencyDialog::on_reset_clicked()
+{
+	Latency::reset();
+	MessagePool::resetLockStats();
+	updateTable();
+}
+
+void LatencyDialog::on_dump_clicked()
+{
+	Latency::dump();
+	qDebug("Latency: message pool locks %d contended, %d spins", MessagePool::getLockContended(), MessagePool::getLockSpins());
+}
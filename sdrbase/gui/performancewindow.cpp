@@ -0,0 +1,79 @@
+#include <iterator>
+#include <QVBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include "gui/performancewindow.h"
+#include "util/metrics.h"
+
+PerformanceWindow::PerformanceWindow(QWidget* parent) :
+	QWidget(parent)
+{
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->setMargin(2);
+
+	m_tree = new QTreeWidget(this);
+	m_tree->setRootIsDecorated(false);
+	m_tree->setColumnCount(4);
+	m_tree->setHeaderLabels(QStringList() << tr("Metric") << tr("Labels") << tr("Value") << tr("Rate [1/s]"));
+	m_tree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+	m_tree->setSortingEnabled(false);
+	layout->addWidget(m_tree);
+
+	connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(updateTable()));
+}
+
+void PerformanceWindow::showEvent(QShowEvent* event)
+{
+	QWidget::showEvent(event);
+	m_interval.start();
+	updateTable();
+	m_updateTimer.start(1000);
+}
+
+void PerformanceWindow::hideEvent(QHideEvent* event)
+{
+	m_updateTimer.stop();
+	QWidget::hideEvent(event);
+}
+
+void PerformanceWindow::updateTable()
+{
+	Metrics::Values values = Metrics::collect();
+	double seconds = m_interval.restart() / 1000.0;
+
+	for(Rows::iterator it = m_rows.begin(); it != m_rows.end(); ++it)
+		it->m_seen = false;
+
+	for(int i = 0; i < values.count(); i++) {
+		const Metrics::Value& value = values[i];
+		QString key = value.m_name + "{" + value.m_labels + "}";
+		Rows::iterator it = m_rows.find(key);
+		if(it == m_rows.end()) {
+			// collect() is sorted, so is the tree
+			Row row;
+			row.m_item = new QTreeWidgetItem(QStringList() << value.m_name << value.m_labels);
+			row.m_item->setToolTip(0, value.m_help);
+			row.m_item->setTextAlignment(2, Qt::AlignRight);
+			row.m_item->setTextAlignment(3, Qt::AlignRight);
+			row.m_lastValue = value.m_value;
+			it = m_rows.insert(key, row);
+			m_tree->insertTopLevelItem(std::distance(m_rows.begin(), it), row.m_item);
+		}
+
+		it->m_item->setText(2, QString::number(value.m_value, 'g', 10));
+		if((value.m_type == Metric::MtCounter) && (seconds > 0))
+			it->m_item->setText(3, QString::number((value.m_value - it->m_lastValue) / seconds, 'f', 2));
+		it->m_lastValue = value.m_value;
+		it->m_seen = true;
+	}
+
+	// metrics of sinks and threads which are gone
+	for(Rows::iterator it = m_rows.begin(); it != m_rows.end(); ) {
+		if(!it->m_seen) {
+			delete it->m_item;
+			it = m_rows.erase(it);
+		} else {
+			++it;
+		}
+	}
+}
@@ -1,6 +1,7 @@
 #include "gui/pluginsdialog.h"
 #include "mainwindow.h"
 #include "ui_pluginsdialog.h"
+#include "dsp/sinkprofile.h"
 
 PluginsDialog::PluginsDialog(PluginManager* pluginManager, QWidget* parent) :
 	QDialog(parent),
@@ -34,9 +35,21 @@ PluginsDialog::PluginsDialog(PluginManager* pluginManager, QWidget* parent) :
 	ui->tree->resizeColumnToContents(0);
 	ui->tree->resizeColumnToContents(1);
 	ui->tree->resizeColumnToContents(2);
+
+	ui->profileEnable->setChecked(SinkProfile::isEnabled());
 }
 
 PluginsDialog::~PluginsDialog()
 {
 	delete ui;
 }
+
+void PluginsDialog::on_profileEnable_toggled(bool checked)
+{
+	SinkProfile::setEnabled(checked);
+}
+
+void PluginsDialog::on_profileReset_clicked()
+{
+	SinkProfile::resetAll();
+}
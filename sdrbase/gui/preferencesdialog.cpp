@@ -1,5 +1,6 @@
 #include <QTreeWidgetItem>
 #include <QAudioDeviceInfo>
+#include <QMessageBox>
 #include "gui/preferencesdialog.h"
 #include "ui_preferencesdialog.h"
 #include "settings/preferences.h"
@@ -54,6 +55,27 @@ PreferencesDialog::PreferencesDialog(Preferences* preferences, QWidget* parent)
 	if(!found)
 		ui->audioRate->setCurrentIndex(1);
 
+	m_threadCpus[ThreadPolicy::TcEngine] = ui->engineCpus;
+	m_threadCpus[ThreadPolicy::TcSource] = ui->sourceCpus;
+	m_threadCpus[ThreadPolicy::TcSink] = ui->sinkCpus;
+	m_threadCpus[ThreadPolicy::TcPipeline] = ui->pipelineCpus;
+	m_threadScheduling[ThreadPolicy::TcEngine] = ui->engineScheduling;
+	m_threadScheduling[ThreadPolicy::TcSource] = ui->sourceScheduling;
+	m_threadScheduling[ThreadPolicy::TcSink] = ui->sinkScheduling;
+	m_threadScheduling[ThreadPolicy::TcPipeline] = ui->pipelineScheduling;
+	m_threadPriority[ThreadPolicy::TcEngine] = ui->enginePriority;
+	m_threadPriority[ThreadPolicy::TcSource] = ui->sourcePriority;
+	m_threadPriority[ThreadPolicy::TcSink] = ui->sinkPriority;
+	m_threadPriority[ThreadPolicy::TcPipeline] = ui->pipelinePriority;
+	ui->pipelinedEngine->setChecked(m_preferences->getPipelinedEngine());
+	ui->pooledChannelSinks->setChecked(m_preferences->getPooledChannelSinks());
+	for(int i = 0; i < ThreadPolicy::TcCount; i++) {
+		const ThreadPolicy::Config& config = m_preferences->getThreadPolicy((ThreadPolicy::ThreadClass)i);
+		m_threadCpus[i]->setText(config.m_cpus);
+		m_threadScheduling[i]->setCurrentIndex(config.m_scheduling);
+		m_threadPriority[i]->setValue(config.m_priority);
+	}
+
 	ui->stackedWidget->setCurrentIndex(0);
 	ui->configTree->setCurrentItem(ui->configTree->topLevelItem(0));
 }
@@ -70,5 +92,32 @@ void PreferencesDialog::accept()
 	else m_preferences->setAudioOutput(QString());
 	m_preferences->setAudioOutputRate(ui->audioRate->itemData(ui->audioRate->currentIndex()).toInt());
 
+	for(int i = 0; i < ThreadPolicy::TcCount; i++) {
+		QList<int> cpus;
+		QString text = m_threadCpus[i]->text().trimmed();
+		if(!text.isEmpty() && !ThreadPolicy::parseCpuSet(text, &cpus)) {
+			ui->configTree->setCurrentItem(ui->configTree->topLevelItem(1));
+			m_threadCpus[i]->setFocus();
+			QMessageBox::warning(this, tr("Invalid CPU List"), tr("\"%1\" is not a valid CPU list. Use numbers and ranges like 0-3,6.").arg(text));
+			return;
+		}
+	}
+	m_preferences->setPipelinedEngine(ui->pipelinedEngine->isChecked());
+	m_preferences->setPooledChannelSinks(ui->pooledChannelSinks->isChecked());
+	for(int i = 0; i < ThreadPolicy::TcCount; i++) {
+		ThreadPolicy::Config config;
+		config.m_cpus = m_threadCpus[i]->text().trimmed();
+		config.m_scheduling = (ThreadPolicy::Scheduling)m_threadScheduling[i]->currentIndex();
+		config.m_priority = m_threadPriority[i]->value();
+		m_preferences->setThreadPolicy((ThreadPolicy::ThreadClass)i, config);
+	}
+
 	QDialog::accept();
 }
+
+void PreferencesDialog::on_configTree_currentItemChanged(QTreeWidgetItem* current, QTreeWidgetItem* previous)
+{
+	Q_UNUSED(previous);
+	if(current != NULL)
+		ui->stackedWidget->setCurrentIndex(ui->configTree->indexOfTopLevelItem(current));
+}
@@ -17,13 +17,20 @@
 
 #include "gui/scopewindow.h"
 #include "ui_scopewindow.h"
+#include "dsp/scopevis.h"
 #include "util/simpleserializer.h"
 
+static const int traceLengths[] = { 10000, 20000, 50000, 100000, 200000, 500000, 1000000 };
+
 ScopeWindow::ScopeWindow(QWidget* parent) :
 	QWidget(parent),
 	ui(new Ui::ScopeWindow),
 	m_sampleRate(0),
-	m_timeBase(1)
+	m_timeBase(1),
+	m_triggerChannel(ScopeVis::TriggerFreeRun),
+	m_triggerLevel(10),
+	m_triggerPre(0),
+	m_traceLength(3)
 {
 	ui->setupUi(this);
 }
@@ -51,6 +58,10 @@ void ScopeWindow::resetToDefaults()
 	m_timeBase = 1;
 	m_timeOffset = 0;
 	m_amplification = 0;
+	m_triggerChannel = ScopeVis::TriggerFreeRun;
+	m_triggerLevel = 10;
+	m_triggerPre = 0;
+	m_traceLength = 3;
 	applySettings();
 }
 
@@ -62,6 +73,10 @@ QByteArray ScopeWindow::serialize() const
 	s.writeS32(3, m_timeBase);
 	s.writeS32(4, m_timeOffset);
 	s.writeS32(5, m_amplification);
+	s.writeS32(6, m_triggerChannel);
+	s.writeS32(7, m_triggerLevel);
+	s.writeS32(8, m_triggerPre);
+	s.writeS32(9, m_traceLength);
 	return s.final();
 }
 
@@ -80,8 +95,14 @@ bool ScopeWindow::deserialize(const QByteArray& data)
 		d.readS32(3, &m_timeBase, 1);
 		d.readS32(4, &m_timeOffset, 0);
 		d.readS32(5, &m_amplification, 0);
+		d.readS32(6, &m_triggerChannel, ScopeVis::TriggerFreeRun);
+		d.readS32(7, &m_triggerLevel, 10);
+		d.readS32(8, &m_triggerPre, 0);
+		d.readS32(9, &m_traceLength, 3);
 		if(m_timeBase < 0)
 			m_timeBase = 1;
+		if((m_traceLength < 0) || (m_traceLength >= (int)(sizeof(traceLengths) / sizeof(traceLengths[0]))))
+			m_traceLength = 3;
 		applySettings();
 		return true;
 	} else {
@@ -148,6 +169,37 @@ void ScopeWindow::on_displayMode_currentIndexChanged(int index)
 	}
 }
 
+void ScopeWindow::on_trigger_currentIndexChanged(int index)
+{
+	m_triggerChannel = index;
+	applyTrigger();
+}
+
+void ScopeWindow::on_triggerLevel_valueChanged(int value)
+{
+	m_triggerLevel = value;
+	applyTrigger();
+}
+
+void ScopeWindow::on_scope_triggerPicked(int channel, int level)
+{
+	// through the controls, so the settings and applyTrigger() see the new trigger
+	ui->trigger->setCurrentIndex(channel);
+	ui->triggerLevel->setValue(level);
+}
+
+void ScopeWindow::on_triggerPre_valueChanged(int value)
+{
+	m_triggerPre = value;
+	applyTrigger();
+}
+
+void ScopeWindow::on_traceLength_currentIndexChanged(int index)
+{
+	m_traceLength = index;
+	applyTrigger();
+}
+
 void ScopeWindow::on_horizView_clicked()
 {
 	m_displayOrientation = Qt::Horizontal;
@@ -186,4 +238,23 @@ void ScopeWindow::applySettings()
 	ui->time->setValue(m_timeBase);
 	ui->timeOfs->setValue(m_timeOffset);
 	ui->amp->setValue(m_amplification);
+	ui->trigger->setCurrentIndex(m_triggerChannel);
+	ui->triggerLevel->setValue(m_triggerLevel);
+	ui->triggerPre->setValue(m_triggerPre);
+	ui->traceLength->setCurrentIndex(m_traceLength);
+	applyTrigger();
+}
+
+void ScopeWindow::applyTrigger()
+{
+	// the trigger re-arms once the signal fell below the high level minus 5% (phase step: half
+	// the step). A magnitude never gets below 0, so its re-arm level stays above half the level.
+	Real high = m_triggerLevel / 100.0;
+	Real low;
+	if(m_triggerChannel == ScopeVis::TriggerPhaseStep)
+		low = high / 2.0;
+	else if(m_triggerChannel == ScopeVis::TriggerMagnitude)
+		low = qMax(high - 0.05, high / 2.0);
+	else low = high - 0.05;
+	ui->scope->setTrigger((ScopeVis::TriggerChannel)m_triggerChannel, high, low, traceLengths[m_traceLength], m_triggerPre);
 }
@@ -0,0 +1,62 @@
+#include <QHeaderView>
+#include "gui/sinkprofilewidget.h"
+#include "dsp/sinkprofile.h"
+
+SinkProfileWidget::SinkProfileWidget(QWidget* parent) :
+	QTreeWidget(parent),
+	m_updateTimer(),
+	m_autoHide(false)
+{
+	setRootIsDecorated(false);
+	setColumnCount(8);
+	setHeaderLabels(QStringList() << tr("Instance") << tr("Stage") << tr("Calls") << tr("Samples")
+		<< tr("Time [ms]") << tr("Max [us]") << tr("ns/Sample") << tr("In/Out"));
+	header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+	connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(updateTable()));
+	m_updateTimer.start(1000);
+}
+
+void SinkProfileWidget::setAutoHide(bool autoHide)
+{
+	m_autoHide = autoHide;
+	updateTable();
+}
+
+void SinkProfileWidget::updateTable()
+{
+	if(m_autoHide)
+		setVisible(SinkProfile::isEnabled());
+	if(!isVisible())
+		return;
+
+	SinkProfile::Snapshots snapshots = SinkProfile::collect();
+
+	while(topLevelItemCount() > snapshots.count())
+		delete takeTopLevelItem(topLevelItemCount() - 1);
+
+	for(int i = 0; i < snapshots.count(); i++) {
+		const SinkProfile::Snapshot& snapshot = snapshots[i];
+		QTreeWidgetItem* item = topLevelItem(i);
+		if(item == NULL) {
+			item = new QTreeWidgetItem(this);
+			for(int column = 2; column < columnCount(); column++)
+				item->setTextAlignment(column, Qt::AlignRight | Qt::AlignVCenter);
+		}
+
+		// channel instances are named after the plugin id, the last part is enough here
+		item->setText(0, snapshot.m_name.section('.', -1));
+		item->setToolTip(0, snapshot.m_name);
+		item->setText(1, snapshot.m_stage);
+		item->setText(2, QString::number(snapshot.m_calls));
+		item->setText(3, QString::number(snapshot.m_samplesIn));
+		item->setText(4, QString::number(snapshot.m_totalNs / 1e6, 'f', 1));
+		item->setText(5, QString::number(snapshot.m_maxNs / 1e3, 'f', 1));
+		if(snapshot.m_samplesIn > 0)
+			item->setText(6, QString::number((double)snapshot.m_totalNs / snapshot.m_samplesIn, 'f', 1));
+		else item->setText(6, "-");
+		if(snapshot.m_samplesOut > 0)
+			item->setText(7, QString::number((double)snapshot.m_samplesIn / snapshot.m_samplesOut, 'f', 1));
+		else item->setText(7, "-");
+	}
+}
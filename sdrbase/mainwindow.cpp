@@ -16,6 +16,7 @@
 ///////////////////////////////////////////////////////////////////////////////////
 
 #include <QInputDialog>
+#include <QFileDialog>
 #include <QMessageBox>
 #include <QLabel>
 #include "mainwindow.h"
@@ -27,12 +28,17 @@
 #include "gui/pluginsdialog.h"
 #include "gui/preferencesdialog.h"
 #include "gui/aboutdialog.h"
+#include "gui/latencydialog.h"
+#include "gui/performancewindow.h"
 #include "gui/rollupwidget.h"
 #include "dsp/dspengine.h"
 #include "dsp/spectrumvis.h"
+#include "dsp/threadedsamplesink.h"
 #include "dsp/dspcommands.h"
 #include "plugin/plugingui.h"
 #include "plugin/pluginapi.h"
+#include "util/threadpolicy.h"
+#include "util/trace.h"
 #include "plugin/plugingui.h"
 
 MainWindow::MainWindow(QWidget* parent) :
@@ -42,8 +48,10 @@ MainWindow::MainWindow(QWidget* parent) :
 	m_settings(),
 	m_dspEngine(new DSPEngine(m_messageQueue)),
 	m_lastEngineState((DSPEngine::State)-1),
+	m_lastOverloadLevel(-1),
 	m_startOsmoSDRUpdateAfterStop(false),
 	m_scopeWindow(NULL),
+	m_latencyDialog(NULL),
 	m_inputGUI(NULL),
 	m_sampleRate(0),
 	m_centerFrequency(0),
@@ -51,6 +59,7 @@ MainWindow::MainWindow(QWidget* parent) :
 {
 	ui->setupUi(this);
 	delete ui->mainToolBar;
+	m_messageQueue->setMetricsName("gui");
 	createStatusBar();
 
 	setCorner(Qt::TopLeftCorner, Qt::LeftDockWidgetArea);
@@ -77,6 +86,14 @@ MainWindow::MainWindow(QWidget* parent) :
 	ui->menu_Window->addAction(ui->presetDock->toggleViewAction());
 	ui->menu_Window->addAction(ui->channelDock->toggleViewAction());
 
+	QDockWidget* performanceDock = new QDockWidget(tr("Performance"), this);
+	performanceDock->setObjectName(QString::fromUtf8("performanceDock"));
+	performanceDock->setWidget(new PerformanceWindow(performanceDock));
+	performanceDock->setAllowedAreas(Qt::AllDockWidgetAreas);
+	addDockWidget(Qt::BottomDockWidgetArea, performanceDock);
+	performanceDock->hide();
+	ui->menu_Window->addAction(performanceDock->toggleViewAction());
+
 	connect(m_messageQueue, SIGNAL(messageEnqueued()), this, SLOT(handleMessages()), Qt::QueuedConnection);
 
 	connect(&m_statusTimer, SIGNAL(timeout()), this, SLOT(updateStatus()));
@@ -87,12 +104,19 @@ MainWindow::MainWindow(QWidget* parent) :
 	m_pluginManager->fillSampleSourceSelector(ui->sampleSource);
 	ui->sampleSource->blockSignals(sampleSourceSignalsBlocked);
 
+	// threads pick up their CPU placement when they start, so the preferences are needed first
+	m_settings.load();
+	applyThreadPolicies();
+
 	m_dspEngine->start();
 
+	// the main spectrum runs on its own thread and drops old samples rather than stalling the engine
 	m_spectrumVis = new SpectrumVis(ui->glSpectrum);
-	m_dspEngine->addSink(m_spectrumVis);
+	m_spectrumVisThread = new ThreadedSampleSink(m_spectrumVis, true);
+	m_spectrumVisThread->setMetricsName("spectrum");
+	m_dspEngine->addSink(m_spectrumVisThread, true);
 
-	ui->glSpectrumGUI->setBuddies(m_dspEngine->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
+	ui->glSpectrumGUI->setBuddies(m_spectrumVisThread->getMessageQueue(), m_spectrumVis, ui->glSpectrum);
 
 	loadSettings();
 
@@ -117,7 +141,8 @@ MainWindow::~MainWindow()
 
 	m_pluginManager->freeAll();
 
-	m_dspEngine->removeSink(m_spectrumVis);
+	m_dspEngine->removeSink(m_spectrumVisThread);
+	delete m_spectrumVisThread;
 	delete m_spectrumVis;
 
 	if(m_scopeWindow != NULL) {
@@ -172,8 +197,6 @@ void MainWindow::setInputGUI(QWidget* gui)
 
 void MainWindow::loadSettings()
 {
-	m_settings.load();
-
 	for(int i = 0; i < m_settings.getPresetCount(); ++i)
 		addPresetToTree(m_settings.getPreset(i));
 
@@ -192,14 +215,23 @@ void MainWindow::loadSettings(const Preset* preset)
 	ui->dcOffset->setChecked(preset->getDCOffsetCorrection());
 	ui->iqImbalance->setChecked(preset->getIQImbalanceCorrection());
 
+	// before the channels of the preset are created
+	m_dspEngine->setPooledChannelSinks(m_settings.getPreferences()->getPooledChannelSinks());
 	m_pluginManager->loadSettings(preset);
 
 	m_dspEngine->configureAudioOutput(m_settings.getPreferences()->getAudioOutput(), m_settings.getPreferences()->getAudioOutputRate());
+	m_dspEngine->configurePipeline(m_settings.getPreferences()->getPipelinedEngine());
 
 	// has to be last step
 	restoreState(preset->getLayout());
 }
 
+void MainWindow::applyThreadPolicies()
+{
+	for(int i = 0; i < ThreadPolicy::TcCount; i++)
+		ThreadPolicy::setConfig((ThreadPolicy::ThreadClass)i, m_settings.getPreferences()->getThreadPolicy((ThreadPolicy::ThreadClass)i));
+}
+
 void MainWindow::saveSettings()
 {
 	saveSettings(m_settings.getCurrent());
@@ -225,6 +257,10 @@ void MainWindow::createStatusBar()
 	m_sampleRateWidget->setToolTip(tr("Sample Rate"));
 	statusBar()->addPermanentWidget(m_sampleRateWidget);
 
+	m_engineLag = new QLabel(tr("Lag: 0 ms"), this);
+	m_engineLag->setToolTip(tr("How far the DSP engine is behind realtime"));
+	statusBar()->addPermanentWidget(m_engineLag);
+
 	m_engineIdle = new Indicator(tr("Idle"), this);
 	m_engineIdle->setToolTip(tr("DSP engine is idle"));
 	statusBar()->addPermanentWidget(m_engineIdle);
@@ -236,6 +272,10 @@ void MainWindow::createStatusBar()
 	m_engineError = new Indicator(tr("Err"), this);
 	m_engineError->setToolTip(tr("DSP engine failed"));
 	statusBar()->addPermanentWidget(m_engineError);
+
+	m_engineOverload = new Indicator(tr("Ovl"), this);
+	m_engineOverload->setToolTip(tr("DSP engine runs at full quality"));
+	statusBar()->addPermanentWidget(m_engineOverload);
 }
 
 void MainWindow::closeEvent(QCloseEvent*)
@@ -315,6 +355,10 @@ void MainWindow::handleMessages()
 			updateCenterFreqDisplay();
 			updateSampleRate();
 			message->completed();
+		} else if(DSPAcquisitionStart::match(message)) {
+			// reply to on_action_Start_triggered()
+			updateStatus();
+			message->completed();
 		} else {
 			if(!m_pluginManager->handleMessage(message))
 				message->completed();
@@ -366,6 +410,25 @@ void MainWindow::updateStatus()
 		}
 		m_lastEngineState = state;
 	}
+
+	int overloadLevel = m_dspEngine->getOverloadLevel();
+	if(m_lastOverloadLevel != overloadLevel) {
+		static const QColor colors[OverloadController::OlCount] = { Qt::gray, Qt::yellow, QColor(0xff, 0x80, 0x00), Qt::red };
+		m_engineOverload->setColor(colors[overloadLevel]);
+		if(overloadLevel == OverloadController::OlNone)
+			m_engineOverload->setToolTip(tr("DSP engine runs at full quality"));
+		else m_engineOverload->setToolTip(tr("DSP engine overloaded: %1").arg(OverloadController::levelName((OverloadController::Level)overloadLevel)));
+		m_lastOverloadLevel = overloadLevel;
+	}
+
+	const QuantumScheduler* scheduler = m_dspEngine->getScheduler();
+	if(overloadLevel == OverloadController::OlNone)
+		m_engineLag->setText(tr("Lag: %1 ms").arg(scheduler->getLagUs() / 1000));
+	else m_engineLag->setText(tr("Lag: %1 ms (%2)").arg(scheduler->getLagUs() / 1000).arg(OverloadController::levelName((OverloadController::Level)overloadLevel)));
+	m_engineLag->setToolTip(tr("How far the DSP engine is behind realtime\nLoad: %1%\nMissed deadlines: %2 of %3 quanta")
+		.arg(scheduler->getLoad() / 10.0, 0, 'f', 1)
+		.arg(scheduler->getMissedDeadlines())
+		.arg(scheduler->getQuanta()));
 }
 
 void MainWindow::updateEnables(bool running)
@@ -386,7 +449,8 @@ void MainWindow::scopeWindowDestroyed()
 
 void MainWindow::on_action_Start_triggered()
 {
-	m_dspEngine->startAcquisition();
+	// opening the device may take a while - do not block the GUI on it
+	m_dspEngine->startAcquisition(m_messageQueue);
 }
 
 void MainWindow::on_action_Stop_triggered()
@@ -516,6 +580,35 @@ void MainWindow::on_action_Oscilloscope_triggered()
 	m_settings.getCurrent()->setShowScope(true);
 }
 
+void MainWindow::on_action_Latency_Statistics_triggered()
+{
+	// modeless, the table keeps updating while the receiver runs
+	if(m_latencyDialog == NULL)
+		m_latencyDialog = new LatencyDialog(this);
+	m_latencyDialog->show();
+	m_latencyDialog->raise();
+}
+
+void MainWindow::on_action_Dump_Trace_triggered()
+{
+	if(!Trace::isCompiledIn()) {
+		QMessageBox::information(this, tr("Dump Trace"), tr("Event tracing is not compiled in. Configure the build with -DENABLE_TRACE=ON to use it."), QMessageBox::Ok);
+		return;
+	}
+
+	bool ok;
+	int seconds = QInputDialog::getInt(this, tr("Dump Trace"), tr("Seconds to dump:"), 10, 1, 600, 1, &ok);
+	if(!ok)
+		return;
+	QString fileName = QFileDialog::getSaveFileName(this, tr("Dump Trace"), "sdrangelove-trace.json", tr("Chrome Trace (*.json)"));
+	if(fileName.isEmpty())
+		return;
+
+	// load the file in chrome://tracing or ui.perfetto.dev
+	if(!Trace::dump(fileName, seconds))
+		QMessageBox::warning(this, tr("Dump Trace"), tr("Cannot write %1").arg(fileName), QMessageBox::Ok);
+}
+
 void MainWindow::on_action_Loaded_Plugins_triggered()
 {
 	PluginsDialog pluginsDialog(m_pluginManager, this);
@@ -529,6 +622,9 @@ void MainWindow::on_action_Preferences_triggered()
 
 	if(preferencesDialog.exec() == QDialog::Accepted) {
 		m_dspEngine->configureAudioOutput(m_settings.getPreferences()->getAudioOutput(), m_settings.getPreferences()->getAudioOutputRate());
+		m_dspEngine->configurePipeline(m_settings.getPreferences()->getPipelinedEngine());
+		m_dspEngine->setPooledChannelSinks(m_settings.getPreferences()->getPooledChannelSinks());
+		applyThreadPolicies();
 	}
 }
 
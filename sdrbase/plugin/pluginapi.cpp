@@ -75,6 +75,16 @@ MessageQueue* PluginAPI::getDSPEngineMessageQueue()
 	return m_dspEngine->getMessageQueue();
 }
 
+SinkWorkerPool* PluginAPI::getSinkWorkerPool()
+{
+	return m_dspEngine->getSinkWorkerPool();
+}
+
+DecoupledSampleSink* PluginAPI::createChannelSink(SampleSink* sampleSink)
+{
+	return m_dspEngine->createChannelSink(sampleSink);
+}
+
 void PluginAPI::addAudioSource(AudioFifo* audioFifo)
 {
 	m_dspEngine->addAudioSource(audioFifo);
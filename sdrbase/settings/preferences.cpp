@@ -10,6 +10,10 @@ void Preferences::resetToDefaults()
 {
 	m_audioOutput.clear();
 	m_audioOutputRate = 44100;
+	m_pipelinedEngine = false;
+	m_pooledChannelSinks = true;
+	for(int i = 0; i < ThreadPolicy::TcCount; i++)
+		m_threadPolicies[i] = ThreadPolicy::Config();
 }
 
 QByteArray Preferences::serialize() const
@@ -17,6 +21,13 @@ QByteArray Preferences::serialize() const
 	SimpleSerializer s(1);
 	s.writeString(1, m_audioOutput);
 	s.writeU32(2, m_audioOutputRate);
+	s.writeBool(3, m_pipelinedEngine);
+	s.writeBool(4, m_pooledChannelSinks);
+	for(int i = 0; i < ThreadPolicy::TcCount; i++) {
+		s.writeString(10 + 3 * i, m_threadPolicies[i].m_cpus);
+		s.writeS32(11 + 3 * i, m_threadPolicies[i].m_scheduling);
+		s.writeS32(12 + 3 * i, m_threadPolicies[i].m_priority);
+	}
 	return s.final();
 }
 
@@ -34,6 +45,15 @@ bool Preferences::deserialize(const QByteArray& data)
 		quint32 tmp;
 		d.readU32(2, &tmp, 44100);
 		m_audioOutputRate = tmp;
+		d.readBool(3, &m_pipelinedEngine, false);
+		d.readBool(4, &m_pooledChannelSinks, true);
+		for(int i = 0; i < ThreadPolicy::TcCount; i++) {
+			qint32 scheduling;
+			d.readString(10 + 3 * i, &m_threadPolicies[i].m_cpus);
+			d.readS32(11 + 3 * i, &scheduling, ThreadPolicy::SchedOther);
+			m_threadPolicies[i].m_scheduling = (ThreadPolicy::Scheduling)scheduling;
+			d.readS32(12 + 3 * i, &m_threadPolicies[i].m_priority, 0);
+		}
 		return true;
 	} else {
 		resetToDefaults();
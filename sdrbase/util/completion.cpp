@@ -0,0 +1,98 @@
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadStorage>
+#include <QElapsedTimer>
+#include "util/completion.h"
+
+class Completion::Waiter {
+public:
+	QMutex m_mutex;
+	QWaitCondition m_condition;
+	bool m_signalled;
+
+	Waiter() :
+		m_mutex(),
+		m_condition(),
+		m_signalled(false)
+	{ }
+};
+
+namespace {
+	QThreadStorage<Completion::Waiter*> completionWaiters;
+
+	Completion::Waiter* threadWaiter()
+	{
+		if(!completionWaiters.hasLocalData())
+			completionWaiters.setLocalData(new Completion::Waiter);
+		return completionWaiters.localData();
+	}
+}
+
+Completion::Completion() :
+	m_state(StIdle),
+	m_result(0),
+	m_waiter(NULL)
+{
+}
+
+void Completion::reset()
+{
+	m_waiter = NULL;
+	m_result = 0;
+	m_state.storeRelease(StIdle);
+}
+
+bool Completion::complete(int result)
+{
+	m_result = result;
+	int state = m_state.fetchAndStoreOrdered(StCompleted);
+	if(state == StAbandoned)
+		return false;
+	if(state != StWaiting)
+		return true; // nobody sleeps yet - the waiter sees the state and returns right away
+
+	// the waiter cannot withdraw any more and stays blocked until signalled, but the object
+	// holding this completion may be gone as soon as it runs again - only touch its waiter
+	Waiter* waiter = m_waiter;
+	waiter->m_mutex.lock();
+	waiter->m_signalled = true;
+	waiter->m_condition.wakeOne();
+	waiter->m_mutex.unlock();
+	return true;
+}
+
+bool Completion::wait(int timeoutMs)
+{
+	if(isCompleted())
+		return true;
+	if(timeoutMs == 0)
+		return !m_state.testAndSetOrdered(StIdle, StAbandoned);
+
+	Waiter* waiter = threadWaiter();
+	waiter->m_mutex.lock();
+	waiter->m_signalled = false;
+	m_waiter = waiter;
+	if(!m_state.testAndSetOrdered(StIdle, StWaiting)) {
+		waiter->m_mutex.unlock();
+		return true;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	while(!waiter->m_signalled) {
+		if(timeoutMs < 0) {
+			waiter->m_condition.wait(&waiter->m_mutex);
+			continue;
+		}
+		qint64 remaining = timeoutMs - timer.elapsed();
+		if((remaining <= 0) && m_state.testAndSetOrdered(StWaiting, StAbandoned)) {
+			// given up before complete() saw us
+			waiter->m_mutex.unlock();
+			return false;
+		}
+		// either time is left or complete() is about to signal
+		waiter->m_condition.wait(&waiter->m_mutex, (remaining > 0) ? remaining : 1);
+	}
+	waiter->m_mutex.unlock();
+	return true;
+}
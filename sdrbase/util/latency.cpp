@@ -0,0 +1,161 @@
+#include <math.h>
+#include <QElapsedTimer>
+#include "util/latency.h"
+
+#if defined(_MSC_VER)
+#define LATENCY_THREAD_LOCAL __declspec(thread)
+#else
+#define LATENCY_THREAD_LOCAL __thread
+#endif
+
+namespace {
+	struct LatencyClock {
+		QElapsedTimer m_timer;
+		LatencyClock() { m_timer.start(); }
+	};
+	LatencyClock latencyClock;
+	LATENCY_THREAD_LOCAL qint64 latencyOrigin = 0;
+}
+
+QAtomicInt Latency::m_enabled(0);
+LatencyHistogram Latency::m_histograms[Latency::StCount];
+
+LatencyHistogram::LatencyHistogram() :
+	m_count(0),
+	m_maximum(0)
+{
+	reset();
+}
+
+void LatencyHistogram::add(qint64 us)
+{
+	if(us < 0)
+		us = 0;
+	else if(us > 0x7fffffff)
+		us = 0x7fffffff;
+
+	m_buckets[bucketIndex(us)].fetchAndAddRelaxed(1);
+	m_count.fetchAndAddOrdered(1);
+
+	int max = m_maximum.loadAcquire();
+	while((us > max) && !m_maximum.testAndSetOrdered(max, us))
+		max = m_maximum.loadAcquire();
+}
+
+void LatencyHistogram::reset()
+{
+	for(int i = 0; i < NumBuckets; i++)
+		m_buckets[i].storeRelease(0);
+	m_count.storeRelease(0);
+	m_maximum.storeRelease(0);
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+	int total = count();
+	if(total == 0)
+		return 0;
+
+	int target = ceil(p * total);
+	if(target < 1)
+		target = 1;
+
+	int sum = 0;
+	for(int i = 0; i < NumBuckets; i++) {
+		sum += m_buckets[i].loadAcquire();
+		if(sum >= target) {
+			qint64 limit = bucketLimit(i);
+			return (limit < maximum()) ? limit : maximum();
+		}
+	}
+	return maximum();
+}
+
+int LatencyHistogram::bucketIndex(quint32 us)
+{
+	if(us < SubSteps)
+		return us;
+
+	int octave = 0;
+	while((us >> octave) >= 2 * SubSteps)
+		octave++;
+	// octave 0 holds SubSteps .. 2 * SubSteps - 1 in steps of one
+	return SubSteps * (octave + 1) + ((us >> octave) & (SubSteps - 1));
+}
+
+qint64 LatencyHistogram::bucketLimit(int index)
+{
+	if(index < SubSteps)
+		return index;
+
+	int octave = index / SubSteps - 1;
+	qint64 lower = (qint64)(SubSteps + index % SubSteps) << octave;
+	return lower + ((qint64)1 << octave) - 1;
+}
+
+void Latency::setEnabled(bool enabled)
+{
+	m_enabled.storeRelease(enabled ? 1 : 0);
+}
+
+qint64 Latency::now()
+{
+	return latencyClock.m_timer.nsecsElapsed() / 1000;
+}
+
+qint64 Latency::origin()
+{
+	return latencyOrigin;
+}
+
+void Latency::setOrigin(qint64 origin)
+{
+	latencyOrigin = origin;
+}
+
+void Latency::record(Stage stage, qint64 us)
+{
+	m_histograms[stage].add(us);
+}
+
+const char* Latency::stageName(Stage stage)
+{
+	switch(stage) {
+		case StSourceFifo:
+			return "Source FIFO";
+		case StEngine:
+			return "DSP engine";
+		case StSinkFifo:
+			return "Sink FIFO";
+		case StChannelizer:
+			return "Channelizer";
+		case StDemod:
+			return "Demodulator";
+		case StAudioFifo:
+			return "Audio FIFO";
+		case StEndToEnd:
+			return "End to end";
+		default:
+			return "?";
+	}
+}
+
+void Latency::reset()
+{
+	for(int i = 0; i < StCount; i++)
+		m_histograms[i].reset();
+}
+
+void Latency::dump()
+{
+	qDebug("Latency: %-12s %8s %10s %10s %10s", "stage", "blocks", "p50 [ms]", "p99 [ms]", "max [ms]");
+	for(int i = 0; i < StCount; i++) {
+		const LatencyHistogram& h = m_histograms[i];
+		qDebug("Latency: %-12s %8d %10.3f %10.3f %10.3f",
+			stageName((Stage)i),
+			h.count(),
+			h.percentile(0.5) / 1000.0,
+			h.percentile(0.99) / 1000.0,
+			h.maximum() / 1000.0);
+	}
+}
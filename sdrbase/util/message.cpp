@@ -1,25 +1,29 @@
-#include <QWaitCondition>
-#include <QMutex>
 #include "util/message.h"
 #include "util/messagequeue.h"
 
 const char* Message::m_identifier = "Message";
 
+namespace {
+	enum {
+		MaxMessageTypes = 1024
+	};
+	// type 0 is Message itself, registerType() only ever appends
+	QAtomicInt messageTypeCount(1);
+	int messageParentTypes[MaxMessageTypes];
+	const char* messageTypeNames[MaxMessageTypes] = { "Message" };
+}
+
 Message::Message() :
 	m_destination(NULL),
+	m_next(NULL),
 	m_synchronous(false),
-	m_waitCondition(NULL),
-	m_mutex(NULL),
-	m_complete(0)
+	m_completion(),
+	m_replyQueue(NULL)
 {
 }
 
 Message::~Message()
 {
-	if(m_waitCondition != NULL)
-		delete m_waitCondition;
-	if(m_mutex != NULL)
-		delete m_mutex;
 }
 
 const char* Message::getIdentifier() const
@@ -39,10 +43,47 @@ bool Message::match(Message* message)
 	return message->matchIdentifier(m_identifier);
 }
 
+int Message::getTypeId() const
+{
+	return 0;
+}
+
+int Message::registerType(const char* name, int parentTypeId)
+{
+	int id = messageTypeCount.fetchAndAddOrdered(1);
+	if(id >= MaxMessageTypes)
+		qFatal("Message: too many message types (%s)", name);
+	messageParentTypes[id] = parentTypeId;
+	messageTypeNames[id] = name;
+	return id;
+}
+
+int Message::parentTypeId(int typeId)
+{
+	return messageParentTypes[typeId];
+}
+
+const char* Message::typeName(int typeId)
+{
+	return messageTypeNames[typeId];
+}
+
+bool Message::isDerivedType(int typeId, int baseTypeId)
+{
+	// every message class derives from Message directly today, so this ends after one step
+	while(typeId != 0) {
+		typeId = messageParentTypes[typeId];
+		if(typeId == baseTypeId)
+			return true;
+	}
+	return false;
+}
+
 void Message::submit(MessageQueue* queue, void* destination)
 {
 	m_destination = destination;
 	m_synchronous = false;
+	m_replyQueue = NULL;
 	queue->submit(this);
 }
 
@@ -50,31 +91,50 @@ int Message::execute(MessageQueue* queue, void* destination)
 {
 	m_destination = destination;
 	m_synchronous = true;
+	m_replyQueue = NULL;
+	m_completion.reset();
 
-	if(m_waitCondition == NULL)
-		m_waitCondition = new QWaitCondition;
-	if(m_mutex == NULL)
-		m_mutex = new QMutex;
+	queue->submit(this);
+	m_completion.wait();
+	return m_completion.getResult();
+}
 
-	m_mutex->lock();
-	m_complete.testAndSetAcquire(0, 1);
+bool Message::tryExecute(MessageQueue* queue, int timeoutMs, int* result, void* destination)
+{
+	m_destination = destination;
+	m_synchronous = true;
+	m_replyQueue = NULL;
+	m_completion.reset();
+
+	queue->submit(this);
+	if(!m_completion.wait(timeoutMs))
+		return false;
+	if(result != NULL)
+		*result = m_completion.getResult();
+	return true;
+}
+
+void Message::submitWithReply(MessageQueue* queue, MessageQueue* replyQueue, void* destination)
+{
+	m_destination = destination;
+	m_synchronous = false;
+	m_replyQueue = replyQueue;
+	m_completion.reset();
 	queue->submit(this);
-	while(!m_complete.testAndSetAcquire(0, 1))
-		((QWaitCondition*)m_waitCondition)->wait(m_mutex, 100);
-	m_complete = 0;
-	int result = m_result;
-	m_mutex->unlock();
-	return result;
 }
 
 void Message::completed(int result)
 {
 	if(m_synchronous) {
-		m_result = result;
-		m_complete = 0;
-		if(m_waitCondition == NULL)
-			qFatal("wait condition is NULL");
-		m_waitCondition->wakeAll();
+		// the caller of execute() may destroy the message right after this - unless it gave up
+		// waiting, then the message is ours to dispose of
+		if(!m_completion.complete(result))
+			delete this;
+	} else if(m_replyQueue != NULL) {
+		MessageQueue* replyQueue = m_replyQueue;
+		m_replyQueue = NULL;
+		m_completion.complete(result);
+		replyQueue->submit(this);
 	} else {
 		delete this;
 	}
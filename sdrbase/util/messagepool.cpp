@@ -0,0 +1,103 @@
+#include <new>
+#include "util/messagepool.h"
+
+MessagePool::SizeClass MessagePool::m_sizeClasses[MessagePool::NumSizeClasses];
+
+void* MessagePool::allocate(size_t size)
+{
+	size_t index = (size + Granularity - 1) / Granularity - 1;
+	if(index >= NumSizeClasses)
+		return ::operator new(size);
+
+	SizeClass* sizeClass = &m_sizeClasses[index];
+	SpinlockHolder spinlockHolder(&sizeClass->m_lock);
+	if(sizeClass->m_free == NULL)
+		grow(sizeClass, (index + 1) * Granularity);
+	Block* block = sizeClass->m_free;
+	sizeClass->m_free = block->m_next;
+	sizeClass->m_freeCount--;
+	return block;
+}
+
+void MessagePool::release(void* ptr, size_t size)
+{
+	if(ptr == NULL)
+		return;
+
+	size_t index = (size + Granularity - 1) / Granularity - 1;
+	if(index >= NumSizeClasses) {
+		::operator delete(ptr);
+		return;
+	}
+
+	SizeClass* sizeClass = &m_sizeClasses[index];
+	Block* block = (Block*)ptr;
+	SpinlockHolder spinlockHolder(&sizeClass->m_lock);
+	block->m_next = sizeClass->m_free;
+	sizeClass->m_free = block;
+	sizeClass->m_freeCount++;
+}
+
+int MessagePool::getAllocated()
+{
+	int allocated = 0;
+	for(int i = 0; i < NumSizeClasses; i++)
+		allocated += m_sizeClasses[i].m_allocated - m_sizeClasses[i].m_freeCount;
+	return allocated;
+}
+
+int MessagePool::getFree()
+{
+	int free = 0;
+	for(int i = 0; i < NumSizeClasses; i++)
+		free += m_sizeClasses[i].m_freeCount;
+	return free;
+}
+
+int MessagePool::getLockContended()
+{
+	int contended = 0;
+	for(int i = 0; i < NumSizeClasses; i++)
+		contended += m_sizeClasses[i].m_lock.getContended();
+	return contended;
+}
+
+int MessagePool::getLockSpins()
+{
+	int spins = 0;
+	for(int i = 0; i < NumSizeClasses; i++)
+		spins += m_sizeClasses[i].m_lock.getSpins();
+	return spins;
+}
+
+void MessagePool::resetLockStats()
+{
+	for(int i = 0; i < NumSizeClasses; i++)
+		m_sizeClasses[i].m_lock.resetStats();
+}
+
+void MessagePool::registerMetrics()
+{
+	// the pool lives until exit, so do these - they are never removed from the registry
+	static bool registered = false;
+	if(registered)
+		return;
+	registered = true;
+	for(int i = 0; i < NumSizeClasses; i++) {
+		SpinlockMetrics* metrics = new SpinlockMetrics(&m_sizeClasses[i].m_lock);
+		metrics->setName(QString("message-pool-%1").arg((i + 1) * Granularity));
+	}
+}
+
+void MessagePool::grow(SizeClass* sizeClass, size_t blockSize)
+{
+	// called with the lock held - this is the only place the pool touches the heap
+	char* slab = (char*)::operator new(blockSize * SlabBlocks);
+	for(int i = SlabBlocks - 1; i >= 0; i--) {
+		Block* block = (Block*)(slab + i * blockSize);
+		block->m_next = sizeClass->m_free;
+		sizeClass->m_free = block;
+	}
+	sizeClass->m_allocated += SlabBlocks;
+	sizeClass->m_freeCount += SlabBlocks;
+}
@@ -3,9 +3,13 @@
 
 MessageQueue::MessageQueue(QObject* parent) :
 	QObject(parent),
-	m_lock(),
-	m_queue()
+	m_pushed(NULL),
+	m_wakeupPending(0),
+	m_batch(NULL),
+	m_batchSize(0),
+	m_depthMetric(Metric::MtGauge, "sdr_message_queue_depth", "Messages waiting in a message queue")
 {
+	setMetricsName(Metrics::instanceName("queue"));
 }
 
 MessageQueue::~MessageQueue()
@@ -17,24 +21,61 @@ MessageQueue::~MessageQueue()
 
 void MessageQueue::submit(Message* message)
 {
-	m_lock.lock();
-	m_queue.append(message);
-	m_lock.unlock();
-	emit messageEnqueued();
+	Message* head;
+	// counted before it can be taken, the depth never goes below zero
+	m_depthMetric.add(1);
+	do {
+		head = m_pushed.loadAcquire();
+		message->m_next = head;
+	} while(!m_pushed.testAndSetOrdered(head, message));
+
+	// only the first message after the consumer ran dry needs to wake it up
+	if(m_wakeupPending.testAndSetOrdered(0, 1))
+		emit messageEnqueued();
 }
 
 Message* MessageQueue::accept()
 {
-	SpinlockHolder spinlockHolder(&m_lock);
-
-	if(m_queue.isEmpty())
+	if(m_batch == NULL)
+		takeBatch();
+	if(m_batch == NULL)
 		return NULL;
-	else return m_queue.takeFirst();
+
+	Message* message = m_batch;
+	m_batch = message->m_next;
+	m_batchSize--;
+	m_depthMetric.add(-1);
+	message->m_next = NULL;
+	return message;
 }
 
 int MessageQueue::countPending()
 {
-	SpinlockHolder spinlockHolder(&m_lock);
+	// producers only ever add in front, so the consumer may walk the list
+	int count = m_batchSize;
+	for(Message* message = m_pushed.loadAcquire(); message != NULL; message = message->m_next)
+		count++;
+	return count;
+}
+
+void MessageQueue::setMetricsName(const QString& name)
+{
+	m_depthMetric.setLabels(QString("queue=\"%1\"").arg(name));
+}
+
+void MessageQueue::takeBatch()
+{
+	// re-arm the wake-up before taking the messages: anything submitted after the exchange
+	// emits a new signal, anything submitted before it is part of this batch
+	m_wakeupPending.fetchAndStoreOrdered(0);
+	Message* message = m_pushed.fetchAndStoreOrdered(NULL);
 
-	return m_queue.size();
+	// the list is newest first - reverse it to deliver in submission order
+	while(message != NULL) {
+		Message* next = message->m_next;
+		message->m_next = m_batch;
+		m_batch = message;
+		m_batchSize++;
+		message = next;
+	}
 }
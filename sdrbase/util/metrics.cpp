@@ -0,0 +1,157 @@
+#include <QMutex>
+#include <QMap>
+#include "util/metrics.h"
+
+#if defined(__linux__)
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+	// the registry is only locked by owners creating, renaming or destroying a metric and by
+	// collect(), never on a hot path
+	QMutex registryMutex;
+	QList<Metric*> registry;
+	QAtomicInt instanceCount(0);
+
+	struct ThreadEntry {
+		QString m_name;
+		int m_tid;
+	};
+	QList<ThreadEntry> threads;
+}
+
+Metric::Metric(Type type, const char* name, const char* help) :
+	m_type(type),
+	m_name(name),
+	m_help(help),
+	m_labels(),
+	m_source(NULL),
+	m_pending(0),
+	m_total(0)
+{
+	Metrics::add(this);
+}
+
+Metric::~Metric()
+{
+	Metrics::remove(this);
+}
+
+void Metric::setLabels(const QString& labels)
+{
+	QMutexLocker mutexLocker(&registryMutex);
+	m_labels = labels;
+}
+
+void Metrics::add(Metric* metric)
+{
+	QMutexLocker mutexLocker(&registryMutex);
+	registry.append(metric);
+}
+
+void Metrics::remove(Metric* metric)
+{
+	QMutexLocker mutexLocker(&registryMutex);
+	registry.removeAll(metric);
+}
+
+QString Metrics::instanceName(const char* prefix)
+{
+	return QString("%1-%2").arg(prefix).arg(instanceCount.fetchAndAddRelaxed(1) + 1);
+}
+
+void Metrics::registerThread(const QString& name)
+{
+#if defined(__linux__)
+	int tid = syscall(SYS_gettid);
+	QMutexLocker mutexLocker(&registryMutex);
+	for(int i = 0; i < threads.count(); i++) {
+		if(threads[i].m_tid == tid) {
+			threads[i].m_name = name;
+			return;
+		}
+	}
+	ThreadEntry entry;
+	entry.m_name = name;
+	entry.m_tid = tid;
+	threads.append(entry);
+#else
+	Q_UNUSED(name);
+#endif
+}
+
+Metrics::Values Metrics::collect()
+{
+	QMap<QString, Value> sorted;
+	QMutexLocker mutexLocker(&registryMutex);
+
+	for(int i = 0; i < registry.count(); i++) {
+		Metric* metric = registry[i];
+		Value value;
+		value.m_name = metric->m_name;
+		value.m_help = metric->m_help;
+		value.m_labels = metric->m_labels;
+		value.m_type = metric->m_type;
+		if(metric->m_source != NULL) {
+			value.m_value = metric->m_source->loadAcquire();
+		} else if(metric->m_type == Metric::MtCounter) {
+			metric->m_total += metric->m_pending.fetchAndStoreOrdered(0);
+			value.m_value = metric->m_total;
+		} else {
+			value.m_value = metric->m_pending.loadAcquire();
+		}
+		sorted.insertMulti(value.m_name + "{" + value.m_labels + "}", value);
+	}
+
+#if defined(__linux__)
+	// the first field of schedstat is the time the thread spent on a CPU in nanoseconds
+	for(int i = 0; i < threads.count(); ) {
+		char path[64];
+		unsigned long long ns = 0;
+		snprintf(path, sizeof(path), "/proc/self/task/%d/schedstat", threads[i].m_tid);
+		FILE* file = fopen(path, "r");
+		if(file == NULL) {
+			// the thread has finished
+			threads.removeAt(i);
+			continue;
+		}
+		bool ok = (fscanf(file, "%llu", &ns) == 1);
+		fclose(file);
+		if(ok) {
+			Value value;
+			value.m_name = "sdr_thread_cpu_seconds_total";
+			value.m_help = "CPU time used by a thread of the receiver";
+			value.m_labels = QString("thread=\"%1\",tid=\"%2\"").arg(threads[i].m_name).arg(threads[i].m_tid);
+			value.m_type = Metric::MtCounter;
+			value.m_value = ns / 1e9;
+			sorted.insertMulti(value.m_name + "{" + value.m_labels + "}", value);
+		}
+		i++;
+	}
+#endif
+
+	return sorted.values();
+}
+
+QString Metrics::exposition()
+{
+	Values values = collect();
+	QString text;
+	QString lastName;
+
+	for(int i = 0; i < values.count(); i++) {
+		const Value& value = values[i];
+		if(value.m_name != lastName) {
+			text += QString("# HELP %1 %2\n").arg(value.m_name).arg(value.m_help);
+			text += QString("# TYPE %1 %2\n").arg(value.m_name).arg(value.m_type == Metric::MtCounter ? "counter" : "gauge");
+			lastName = value.m_name;
+		}
+		if(value.m_labels.isEmpty())
+			text += QString("%1 %2\n").arg(value.m_name).arg(value.m_value, 0, 'g', 15);
+		else text += QString("%1{%2} %3\n").arg(value.m_name).arg(value.m_labels).arg(value.m_value, 0, 'g', 15);
+	}
+
+	return text;
+}
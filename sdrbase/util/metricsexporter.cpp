@@ -0,0 +1,105 @@
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDateTime>
+#include "util/metricsexporter.h"
+#include "util/metrics.h"
+
+MetricsExporter::MetricsExporter(QObject* parent) :
+	QObject(parent),
+	m_server(NULL),
+	m_logFile(),
+	m_logTimer()
+{
+	connect(&m_logTimer, SIGNAL(timeout()), this, SLOT(writeLog()));
+}
+
+MetricsExporter::~MetricsExporter()
+{
+	if(m_logFile.isOpen()) {
+		writeLog();
+		m_logFile.close();
+	}
+}
+
+bool MetricsExporter::listen(quint16 port)
+{
+	if(m_server == NULL) {
+		m_server = new QTcpServer(this);
+		connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
+	}
+
+	// local only, the endpoint has no authentication
+	if(!m_server->listen(QHostAddress::LocalHost, port)) {
+		qWarning("MetricsExporter: cannot listen on port %u: %s", port, qPrintable(m_server->errorString()));
+		return false;
+	}
+	qDebug("MetricsExporter: serving metrics on http://127.0.0.1:%u/metrics", port);
+	return true;
+}
+
+bool MetricsExporter::startLog(const QString& fileName, int intervalS)
+{
+	if(m_logFile.isOpen())
+		m_logFile.close();
+
+	m_logFile.setFileName(fileName);
+	if(!m_logFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+		qWarning("MetricsExporter: cannot open %s: %s", qPrintable(fileName), qPrintable(m_logFile.errorString()));
+		return false;
+	}
+
+	if(intervalS < 1)
+		intervalS = 1;
+	m_logTimer.start(intervalS * 1000);
+	qDebug("MetricsExporter: logging metrics to %s every %d s", qPrintable(fileName), intervalS);
+	return true;
+}
+
+void MetricsExporter::newConnection()
+{
+	QTcpSocket* socket;
+	while((socket = m_server->nextPendingConnection()) != NULL) {
+		connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+		connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+	}
+}
+
+void MetricsExporter::readRequest()
+{
+	QTcpSocket* socket = qobject_cast<QTcpSocket*>(sender());
+	if(socket == NULL)
+		return;
+
+	// answer as soon as the request line is there, what was requested does not matter
+	if(!socket->canReadLine())
+		return;
+	socket->readAll();
+	disconnect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+
+	QByteArray body = Metrics::exposition().toUtf8();
+	QByteArray response;
+	response += "HTTP/1.0 200 OK\r\n";
+	response += "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+	response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+	response += "Connection: close\r\n\r\n";
+	response += body;
+	socket->write(response);
+	socket->disconnectFromHost();
+}
+
+void MetricsExporter::writeLog()
+{
+	if(!m_logFile.isOpen())
+		return;
+
+	// one block per snapshot, every line carries the time so the file can be grepped
+	QString timestamp = QDateTime::currentDateTime().toString(Qt::ISODate);
+	Metrics::Values values = Metrics::collect();
+	QString text;
+	for(int i = 0; i < values.count(); i++) {
+		const Metrics::Value& value = values[i];
+		text += QString("%1 %2{%3} %4\n").arg(timestamp).arg(value.m_name).arg(value.m_labels).arg(value.m_value, 0, 'g', 15);
+	}
+	m_logFile.write(text.toUtf8());
+	m_logFile.flush();
+}
@@ -1 +1,72 @@
+#include <QThread>
 #include "util/spinlock.h"
+
+#ifdef USE_SIMD
+#include <emmintrin.h>
+#endif
+
+QAtomicInt Spinlock::m_statsEnabled(0);
+
+static inline void cpuRelax()
+{
+#ifdef USE_SIMD
+	_mm_pause();
+#endif
+}
+
+void Spinlock::setStatsEnabled(bool enabled)
+{
+	m_statsEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+void Spinlock::resetStats()
+{
+	m_contended.storeRelease(0);
+	m_spins.storeRelease(0);
+}
+
+SpinlockMetrics::SpinlockMetrics(const Spinlock* spinlock) :
+	m_contendedMetric(Metric::MtCounter, "sdr_spinlock_contended_total", "Lock operations which found a spinlock taken (counted while lock statistics are on)"),
+	m_spinsMetric(Metric::MtCounter, "sdr_spinlock_spins_total", "Pause instructions spent waiting for a spinlock (counted while lock statistics are on)")
+{
+	m_contendedMetric.setSource(&spinlock->m_contended);
+	m_spinsMetric.setSource(&spinlock->m_spins);
+}
+
+void SpinlockMetrics::setName(const QString& name)
+{
+	QString labels = QString("lock=\"%1\"").arg(name);
+	m_contendedMetric.setLabels(labels);
+	m_spinsMetric.setLabels(labels);
+}
+
+void Spinlock::lockContended()
+{
+	int backoff = 1;
+	int rounds = 0;
+	int spins = 0;
+
+	do {
+		// only read while the lock is taken - a failing CAS would pull the cache line away from the holder
+		while(m_atomic.loadAcquire() != 0) {
+			if(rounds < SpinRounds) {
+				for(int i = 0; i < backoff; i++)
+					cpuRelax();
+				spins += backoff;
+				if(backoff < MaxBackoff)
+					backoff <<= 1;
+			} else if(rounds < SpinRounds + YieldRounds) {
+				QThread::yieldCurrentThread();
+			} else {
+				// the holder is most likely not running at all
+				QThread::usleep(SleepUs);
+			}
+			rounds++;
+		}
+	} while(!m_atomic.testAndSetAcquire(0, 1));
+
+	if(isStatsEnabled()) {
+		m_contended.fetchAndAddRelaxed(1);
+		m_spins.fetchAndAddRelaxed(spins);
+	}
+}
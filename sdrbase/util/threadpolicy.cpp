@@ -0,0 +1,228 @@
+#include <QStringList>
+#include "util/threadpolicy.h"
+#include "util/metrics.h"
+#include "util/trace.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#endif
+
+QMutex ThreadPolicy::m_mutex;
+ThreadPolicy::Config ThreadPolicy::m_configs[ThreadPolicy::TcCount];
+bool ThreadPolicy::m_overridden[ThreadPolicy::TcCount] = { false, false, false, false };
+
+void ThreadPolicy::setConfig(ThreadClass threadClass, const Config& config)
+{
+	QMutexLocker mutexLocker(&m_mutex);
+	if(!m_overridden[threadClass])
+		m_configs[threadClass] = config;
+}
+
+ThreadPolicy::Config ThreadPolicy::getConfig(ThreadClass threadClass)
+{
+	QMutexLocker mutexLocker(&m_mutex);
+	return m_configs[threadClass];
+}
+
+bool ThreadPolicy::setOverride(const QString& spec)
+{
+	QStringList parts = spec.split(':');
+	if((parts.size() < 2) || (parts.size() > 4))
+		return false;
+
+	int threadClass;
+	for(threadClass = 0; threadClass < TcCount; threadClass++) {
+		if(parts[0] == className((ThreadClass)threadClass))
+			break;
+	}
+	if(threadClass >= TcCount)
+		return false;
+
+	Config config;
+	QList<int> cpus;
+	config.m_cpus = parts[1];
+	if(!config.m_cpus.isEmpty() && !parseCpuSet(config.m_cpus, &cpus))
+		return false;
+
+	if(parts.size() > 2) {
+		if(parts[2] == "fifo")
+			config.m_scheduling = SchedFifo;
+		else if(parts[2] == "rr")
+			config.m_scheduling = SchedRR;
+		else if((parts[2] == "other") || parts[2].isEmpty())
+			config.m_scheduling = SchedOther;
+		else return false;
+	}
+
+	if(parts.size() > 3) {
+		bool ok;
+		config.m_priority = parts[3].toInt(&ok);
+		if(!ok)
+			return false;
+	}
+
+	QMutexLocker mutexLocker(&m_mutex);
+	m_configs[threadClass] = config;
+	m_overridden[threadClass] = true;
+	return true;
+}
+
+const char* ThreadPolicy::usage()
+{
+	return
+		"--thread-policy <class>:<cpus>[:<policy>[:<priority>]]\n"
+		"    class:    engine, source, sink or pipeline\n"
+		"    cpus:     CPU list like 0-3,6 - empty for all CPUs\n"
+		"    policy:   other (default), fifo or rr\n"
+		"    priority: realtime priority for fifo and rr\n"
+		"    example:  --thread-policy engine:2-3:fifo:50\n";
+}
+
+const char* ThreadPolicy::className(ThreadClass threadClass)
+{
+	switch(threadClass) {
+		case TcEngine:
+			return "engine";
+		case TcSource:
+			return "source";
+		case TcSink:
+			return "sink";
+		case TcPipeline:
+			return "pipeline";
+		default:
+			return "?";
+	}
+}
+
+const char* ThreadPolicy::schedulingName(Scheduling scheduling)
+{
+	switch(scheduling) {
+		case SchedFifo:
+			return "SCHED_FIFO";
+		case SchedRR:
+			return "SCHED_RR";
+		default:
+			return "SCHED_OTHER";
+	}
+}
+
+bool ThreadPolicy::parseCpuSet(const QString& cpus, QList<int>* result)
+{
+	result->clear();
+
+	QStringList ranges = cpus.split(',', QString::SkipEmptyParts);
+	if(ranges.isEmpty())
+		return false;
+
+	for(int i = 0; i < ranges.size(); i++) {
+		QStringList bounds = ranges[i].trimmed().split('-');
+		if(bounds.size() > 2)
+			return false;
+		bool ok1;
+		bool ok2 = true;
+		int first = bounds[0].toInt(&ok1);
+		int last = first;
+		if(bounds.size() > 1)
+			last = bounds[1].toInt(&ok2);
+		if(!ok1 || !ok2 || (first < 0) || (last < first) || (last >= 1024))
+			return false;
+		for(int cpu = first; cpu <= last; cpu++) {
+			if(!result->contains(cpu))
+				result->append(cpu);
+		}
+	}
+	return true;
+}
+
+#if defined(__linux__)
+
+static QString formatCpuSet(const cpu_set_t& set)
+{
+	QStringList ranges;
+	int cpu = 0;
+	while(cpu < CPU_SETSIZE) {
+		if(!CPU_ISSET(cpu, &set)) {
+			cpu++;
+			continue;
+		}
+		int first = cpu;
+		while((cpu + 1 < CPU_SETSIZE) && CPU_ISSET(cpu + 1, &set))
+			cpu++;
+		if(first == cpu)
+			ranges.append(QString::number(first));
+		else ranges.append(QString("%1-%2").arg(first).arg(cpu));
+		cpu++;
+	}
+	return ranges.join(",");
+}
+
+void ThreadPolicy::apply(ThreadClass threadClass, const char* name)
+{
+	Config config = getConfig(threadClass);
+	pthread_t self = pthread_self();
+	int res;
+
+	// the kernel keeps 15 characters
+	char shortName[16];
+	strncpy(shortName, name, sizeof(shortName) - 1);
+	shortName[sizeof(shortName) - 1] = '\0';
+	pthread_setname_np(self, shortName);
+	Metrics::registerThread(name);
+	Trace::setThreadName(name);
+
+	if(!config.m_cpus.isEmpty()) {
+		QList<int> cpus;
+		if(!parseCpuSet(config.m_cpus, &cpus)) {
+			qWarning("ThreadPolicy: %s: invalid CPU list \"%s\" - not pinned", name, qPrintable(config.m_cpus));
+		} else {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for(int i = 0; i < cpus.size(); i++) {
+				if(cpus[i] < CPU_SETSIZE)
+					CPU_SET(cpus[i], &set);
+			}
+			if((res = pthread_setaffinity_np(self, sizeof(set), &set)) != 0)
+				qWarning("ThreadPolicy: %s: cannot pin to CPUs %s: %s - not pinned", name, qPrintable(config.m_cpus), strerror(res));
+		}
+	}
+
+	if(config.m_scheduling != SchedOther) {
+		int policy = (config.m_scheduling == SchedFifo) ? SCHED_FIFO : SCHED_RR;
+		struct sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = qBound(sched_get_priority_min(policy), config.m_priority, sched_get_priority_max(policy));
+		if((res = pthread_setschedparam(self, policy, &param)) != 0) {
+			qWarning("ThreadPolicy: %s: cannot switch to %s priority %d: %s - keeping the default policy (needs CAP_SYS_NICE or an rtprio limit)",
+				name, schedulingName(config.m_scheduling), param.sched_priority, strerror(res));
+		}
+	}
+
+	// report what the thread actually got
+	int policy;
+	struct sched_param param;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	pthread_getschedparam(self, &policy, &param);
+	pthread_getaffinity_np(self, sizeof(set), &set);
+	qDebug("ThreadPolicy: %s (%s): %s priority %d on CPUs %s",
+		name,
+		className(threadClass),
+		(policy == SCHED_FIFO) ? "SCHED_FIFO" : (policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER",
+		param.sched_priority,
+		qPrintable(formatCpuSet(set)));
+}
+
+#else // __linux__
+
+void ThreadPolicy::apply(ThreadClass threadClass, const char* name)
+{
+	Config config = getConfig(threadClass);
+	Metrics::registerThread(name);
+	Trace::setThreadName(name);
+	if(!config.m_cpus.isEmpty() || (config.m_scheduling != SchedOther))
+		qWarning("ThreadPolicy: %s: CPU pinning and realtime scheduling are only supported on Linux", name);
+}
+
+#endif // __linux__
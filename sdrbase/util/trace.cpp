@@ -0,0 +1,178 @@
+#include "util/trace.h"
+
+#ifdef USE_TRACE
+
+#include <stdio.h>
+#include <vector>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QStringList>
+#include <QFile>
+#include <QCoreApplication>
+
+#if defined(_MSC_VER)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+namespace {
+	struct TraceEvent {
+		qint64 m_ns;
+		const char* m_name;
+		char m_phase;
+	};
+
+	// only written by its thread: the event first, then the head is published
+	struct TraceRing {
+		enum {
+			Size = 16384 // a power of two, the head wraps around cleanly
+		};
+		TraceEvent m_events[Size];
+		QAtomicInt m_head;
+		QString m_name;
+		int m_id;
+	};
+
+	struct TraceClock {
+		QElapsedTimer m_timer;
+		TraceClock() { m_timer.start(); }
+	};
+	TraceClock traceClock;
+
+	// rings stay allocated when their thread finishes so its events can still be dumped
+	QMutex registryMutex;
+	QList<TraceRing*> registry;
+	TRACE_THREAD_LOCAL TraceRing* traceRing = NULL;
+
+	TraceRing* threadRing()
+	{
+		if(traceRing == NULL) {
+			TraceRing* ring = new TraceRing;
+			QMutexLocker mutexLocker(&registryMutex);
+			ring->m_id = registry.count() + 1;
+			ring->m_name = QString("thread-%1").arg(ring->m_id);
+			registry.append(ring);
+			traceRing = ring;
+		}
+		return traceRing;
+	}
+}
+
+bool Trace::isCompiledIn()
+{
+	return true;
+}
+
+void Trace::record(const char* name, Phase phase)
+{
+	TraceRing* ring = threadRing();
+	quint32 head = ring->m_head.load();
+	TraceEvent& event = ring->m_events[head % TraceRing::Size];
+	event.m_ns = traceClock.m_timer.nsecsElapsed();
+	event.m_name = name;
+	event.m_phase = phase;
+	ring->m_head.storeRelease(head + 1);
+}
+
+void Trace::setThreadName(const QString& name)
+{
+	TraceRing* ring = threadRing();
+	QMutexLocker mutexLocker(&registryMutex);
+	ring->m_name = name;
+}
+
+bool Trace::dump(const QString& fileName, int seconds)
+{
+	QFile file(fileName);
+	if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		qWarning("Trace: cannot open %s: %s", qPrintable(fileName), qPrintable(file.errorString()));
+		return false;
+	}
+
+	qint64 since = traceClock.m_timer.nsecsElapsed() - (qint64)seconds * 1000000000LL;
+	qint64 pid = QCoreApplication::applicationPid();
+	QList<TraceRing*> rings;
+	QStringList names;
+	{
+		QMutexLocker mutexLocker(&registryMutex);
+		rings = registry;
+		for(int i = 0; i < rings.count(); i++)
+			names.append(rings[i]->m_name);
+	}
+
+	QByteArray json("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	std::vector<TraceEvent> events;
+	char line[256];
+	int count = 0;
+
+	for(int i = 0; i < rings.count(); i++) {
+		TraceRing* ring = rings[i];
+		snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lld,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			pid, ring->m_id, qPrintable(names[i]));
+		if(i > 0)
+			json += ",\n";
+		json += line;
+
+		// copy without stopping the writer, then drop whatever it overwrote meanwhile
+		quint32 head = ring->m_head.loadAcquire();
+		quint32 available = (head < (quint32)TraceRing::Size) ? head : (quint32)TraceRing::Size;
+		events.resize(available);
+		for(quint32 n = 0; n < available; n++)
+			events[n] = ring->m_events[(head - available + n) % TraceRing::Size];
+		// the slot the writer is filling right now counts as overwritten as well
+		quint32 written = ring->m_head.fetchAndAddOrdered(0) - head + 1;
+		quint32 unused = (quint32)TraceRing::Size - available;
+		quint32 overwritten = (written > unused) ? written - unused : 0;
+		if(overwritten > available)
+			overwritten = available;
+
+		for(quint32 n = overwritten; n < available; n++) {
+			const TraceEvent& event = events[n];
+			if(event.m_ns < since)
+				continue;
+			snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lld,\"tid\":%d%s}",
+				event.m_name, event.m_phase, event.m_ns / 1000.0, pid, ring->m_id,
+				(event.m_phase == PhInstant) ? ",\"s\":\"t\"" : "");
+			json += line;
+			count++;
+		}
+	}
+	json += "\n]}\n";
+
+	bool ok = (file.write(json) == json.size());
+	file.close();
+	if(ok)
+		qDebug("Trace: wrote %d events of %d threads to %s", count, rings.count(), qPrintable(fileName));
+	else qWarning("Trace: cannot write %s: %s", qPrintable(fileName), qPrintable(file.errorString()));
+	return ok;
+}
+
+#else // USE_TRACE
+
+bool Trace::isCompiledIn()
+{
+	return false;
+}
+
+void Trace::record(const char* name, Phase phase)
+{
+	Q_UNUSED(name);
+	Q_UNUSED(phase);
+}
+
+void Trace::setThreadName(const QString& name)
+{
+	Q_UNUSED(name);
+}
+
+bool Trace::dump(const QString& fileName, int seconds)
+{
+	Q_UNUSED(fileName);
+	Q_UNUSED(seconds);
+	qWarning("Trace: not compiled in, configure with -DENABLE_TRACE=ON");
+	return false;
+}
+
+#endif // USE_TRACE